@@ -48,6 +48,20 @@ struct rtl8366_vlan_4k {
 	u8	fid;
 };
 
+/*
+ * struct rtl83xx_table_state - indirect table access engine state
+ * @addr: last value written to the table address register
+ * @addr_valid: @addr matches the contents of the table address register
+ * @busy: a command was issued without waiting for its completion
+ *
+ * Protected by realtek_priv.map_lock.
+ */
+struct rtl83xx_table_state {
+	u32	addr;
+	bool	addr_valid;
+	bool	busy;
+};
+
 struct realtek_priv {
 	struct device		*dev;
 	struct reset_control    *reset_ctl;
@@ -80,6 +94,8 @@ struct realtek_priv {
 	int			vlan_enabled;
 	int			vlan4k_enabled;
 
+	struct rtl83xx_table_state table;
+
 	char			buf[4096];
 	void			*chip_data; /* Per-chip extra variant data */
 };
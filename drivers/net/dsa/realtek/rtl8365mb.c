@@ -92,13 +92,19 @@
 
 #include <linux/bitfield.h>
 #include <linux/bitops.h>
+#include <linux/hashtable.h>
 #include <linux/interrupt.h>
 #include <linux/irqdomain.h>
+#include <linux/jhash.h>
 #include <linux/mutex.h>
 #include <linux/of_irq.h>
 #include <linux/regmap.h>
+#include <linux/rtnetlink.h>
 #include <linux/if_bridge.h>
 #include <linux/if_vlan.h>
+#include <net/flow_offload.h>
+#include <net/ndisc.h>
+#include <net/switchdev.h>
 
 #include "realtek.h"
 #include "realtek-smi.h"
@@ -112,6 +118,11 @@
 #define RTL8365MB_MAX_NUM_PORTS		11
 #define RTL8365MB_MAX_NUM_EXTINTS	3
 #define RTL8365MB_LEARN_LIMIT_MAX	2112
+#define RTL8365MB_NUM_FIDS		16
+/* FID 0 is kept for the CPU port and for VLAN 0 */
+#define RTL8365MB_FID_DEFAULT		0
+#define RTL8365MB_MAX_NUM_BRIDGES	(RTL8365MB_NUM_FIDS - 1)
+#define RTL8365MB_NUM_PRIORITIES	8
 
 /* Chip identification registers */
 #define RTL8365MB_CHIP_ID_REG		0x1300
@@ -162,6 +173,9 @@
 		 RTL8365MB_INTR_LINK_CHANGE_MASK)
 
 /* Per-port interrupt type status registers */
+#define RTL8365MB_PORT_LEARN_OVER_IND_REG	0x1103
+#define   RTL8365MB_PORT_LEARN_OVER_IND_MASK	0x07FF
+
 #define RTL8365MB_PORT_LINKDOWN_IND_REG		0x1106
 #define   RTL8365MB_PORT_LINKDOWN_IND_MASK	0x07FF
 
@@ -273,11 +287,79 @@
 #define   RTL8365MB_CFG0_MAX_LEN_MASK	0x3FFF
 #define RTL8365MB_CFG0_MAX_LEN_MAX	0x3FFF
 
+/* L2 lookup table configuration register */
+#define RTL8365MB_LUT_CFG_REG				0x0A30
+#define   RTL8365MB_LUT_CFG_AGE_TIMER_MASK		GENMASK(3, 1)
+#define   RTL8365MB_LUT_CFG_AGE_SPEED_MASK		GENMASK(5, 4)
+/* Look up IP multicast by group IP address instead of group MAC address */
+#define   RTL8365MB_LUT_CFG_IPMC_L3_LOOKUP_MASK		GENMASK(7, 7)
+
+/* Range of the L2 ageing timer */
+#define RTL8365MB_AGEING_TIME_MIN			(45 * MSEC_PER_SEC)
+#define RTL8365MB_AGEING_TIME_MAX			(916 * MSEC_PER_SEC)
+
+/* IGMP/MLD snooping - per-port handling of each protocol version */
+#define RTL8365MB_IGMP_PORT_CTRL_BASE			0x0904
+#define RTL8365MB_IGMP_PORT_CTRL_REG(_physport) \
+		(RTL8365MB_IGMP_PORT_CTRL_BASE + (_physport))
+#define   RTL8365MB_IGMP_PORT_CTRL_IGMPV1_OP_MASK	GENMASK(1, 0)
+#define   RTL8365MB_IGMP_PORT_CTRL_IGMPV2_OP_MASK	GENMASK(3, 2)
+#define   RTL8365MB_IGMP_PORT_CTRL_IGMPV3_OP_MASK	GENMASK(5, 4)
+#define   RTL8365MB_IGMP_PORT_CTRL_MLDV1_OP_MASK	GENMASK(7, 6)
+#define   RTL8365MB_IGMP_PORT_CTRL_MLDV2_OP_MASK	GENMASK(9, 8)
+
+enum rtl8365mb_igmp_op {
+	RTL8365MB_IGMP_OP_ASIC = 0,
+	RTL8365MB_IGMP_OP_FLOOD,
+	RTL8365MB_IGMP_OP_TRAP,
+	RTL8365MB_IGMP_OP_DROP,
+};
+
 /* Port learning limit registers */
 #define RTL8365MB_LUT_PORT_LEARN_LIMIT_BASE		0x0A20
 #define RTL8365MB_LUT_PORT_LEARN_LIMIT_REG(_physport) \
 		(RTL8365MB_LUT_PORT_LEARN_LIMIT_BASE + (_physport))
 
+/* Port security control register */
+#define RTL8365MB_PORT_SECURITY_CTRL_REG		0x08C8
+/* Switch-wide action on frames whose source address a port cannot learn
+ * because it has reached its learning limit
+ */
+#define   RTL8365MB_PORT_SECURITY_CTRL_LEARN_OVER_ACT_MASK	GENMASK(5, 4)
+
+enum rtl8365mb_learn_over_act {
+	RTL8365MB_LEARN_OVER_ACT_FORWARD = 0,
+	RTL8365MB_LEARN_OVER_ACT_DROP,
+	RTL8365MB_LEARN_OVER_ACT_TRAP,
+};
+
+/* Port-based FID registers - take precedence over the FID of the VLAN */
+#define RTL8365MB_PORT_PBFIDEN_REG			0x0A32
+#define RTL8365MB_PORT_PBFID_BASE			0x0A33
+#define RTL8365MB_PORT_PBFID_REG(_physport) \
+		(RTL8365MB_PORT_PBFID_BASE + (_physport))
+#define   RTL8365MB_PORT_PBFID_MASK			GENMASK(3, 0)
+
+/* L2 table flush engine - writing a port mask starts flushing the entries
+ * learned on those ports, each bit clears once its port is done
+ */
+#define RTL8365MB_L2_FORCE_FLUSH_REG			0x0A44
+#define   RTL8365MB_L2_FORCE_FLUSH_PORTMASK_MASK	GENMASK(10, 0)
+#define RTL8365MB_L2_FLUSH_CTRL1_REG			0x0A45
+#define   RTL8365MB_L2_FLUSH_CTRL1_VID_MASK		GENMASK(11, 0)
+#define RTL8365MB_L2_FLUSH_CTRL2_REG			0x0A46
+#define   RTL8365MB_L2_FLUSH_CTRL2_FID_MASK		GENMASK(3, 0)
+#define   RTL8365MB_L2_FLUSH_CTRL2_MODE_MASK		GENMASK(5, 4)
+/* Flush static entries as well as dynamic ones */
+#define   RTL8365MB_L2_FLUSH_CTRL2_TYPE_MASK		GENMASK(6, 6)
+#define RTL8365MB_L2_FLUSH_TIMEOUT_US			100000
+
+/* Flood port masks - ports receiving flooded frames of each kind */
+#define RTL8365MB_UNKNOWN_UC_FLOOD_PMSK_REG		0x0890
+#define RTL8365MB_UNKNOWN_MC_FLOOD_PMSK_REG		0x0891
+#define RTL8365MB_BC_FLOOD_PMSK_REG			0x0892
+#define   RTL8365MB_FLOOD_PMSK_MASK			GENMASK(10, 0)
+
 /* Port isolation (forwarding mask) registers */
 #define RTL8365MB_PORT_ISOLATION_REG_BASE		0x08A2
 #define RTL8365MB_PORT_ISOLATION_REG(_physport) \
@@ -306,6 +388,18 @@
 #define   RTL8365MB_MIB_CTRL0_RESET_MASK	0x0002
 #define   RTL8365MB_MIB_CTRL0_BUSY_MASK		0x0001
 
+/* ACL log counters - 32 bit counters following the port MIB counters, in
+ * pairs sharing one MIB address. The first counter of a pair counts packets
+ * and the second one counts bytes if the pair's log type bit is set.
+ */
+#define RTL8365MB_MIB_LOG_CNT_OFFSET		0x03E0
+#define RTL8365MB_NUM_LOG_CNT_PAIRS		16
+#define   RTL8365MB_MIB_LOG_CNT_ADDRESS(_n) \
+		((RTL8365MB_MIB_LOG_CNT_OFFSET + ((_n) << 2)) >> 2)
+
+#define RTL8365MB_MIB_LOG_TYPE_REG		0x1008
+#define   RTL8365MB_MIB_LOG_TYPE_BYTES_MASK	GENMASK(15, 0)
+
 /* The DSA callback .get_stats64 runs in atomic context, so we are not allowed
  * to block. On the other hand, accessing MIB counters absolutely requires us to
  * block. The solution is thus to schedule work which polls the MIB counters
@@ -379,6 +473,7 @@
 #define RTL8365MB_VLAN_4K_CONF1_ENVLANPOL_MASK		GENMASK(8, 8)
 #define RTL8365MB_VLAN_4K_CONF1_METER_IDX_LS_MASK	GENMASK(13, 9)
 #define RTL8365MB_VLAN_4K_CONF2_METER_IDX_MS_MASK	GENMASK(6, 6)
+#define RTL8365MB_VLAN_4K_CONF1_IVL_SVL_MASK		GENMASK(14, 14)
 
 /* VLAN MC registers */
 #define RTL8365MB_VLAN_MC_CONF_BASE			0x0728
@@ -395,6 +490,419 @@
 #define  RTL8365MB_VLAN_MC_CONF2_METER_IDX_MSK		GENMASK(10, 5)
 #define  RTL8365MB_VLAN_MC_CONF3_EVID_MSK		GENMASK(12, 0)
 
+/* SVLAN (802.1ad service VLAN) registers */
+#define RTL8365MB_SVLAN_UPLINK_PORTMASK_REG		0x0C01
+#define   RTL8365MB_SVLAN_UPLINK_PORTMASK_MASK		GENMASK(10, 0)
+/* Take the egress member set of S-tagged frames from the SVLAN table */
+#define RTL8365MB_SVLAN_LOOKUP_TYPE_REG			0x0C02
+#define   RTL8365MB_SVLAN_LOOKUP_TYPE_MASK		GENMASK(0, 0)
+/* Port-based SVLAN member config index, used for frames without S-tag */
+#define RTL8365MB_SVLAN_PORTBASED_SVIDX_BASE		0x0C05
+#define RTL8365MB_SVLAN_PORTBASED_SVIDX_REG(_physport) \
+		(RTL8365MB_SVLAN_PORTBASED_SVIDX_BASE + ((_physport) >> 1))
+#define   RTL8365MB_SVLAN_PORTBASED_SVIDX_OFFSET(_physport) \
+		(((_physport) & 1) << 3)
+#define   RTL8365MB_SVLAN_PORTBASED_SVIDX_MASK(_physport) \
+		(0x3F << RTL8365MB_SVLAN_PORTBASED_SVIDX_OFFSET(_physport))
+
+/* SVLAN member configuration entries: three words plus an extension word */
+#define RTL8365MB_SVLAN_MC_CONF_BASE			0x0C10
+#define RTL8365MB_SVLAN_MC_CONF_REG(_index) \
+		(RTL8365MB_SVLAN_MC_CONF_BASE + 3 * (_index))
+#define RTL8365MB_SVLAN_MC_CONF_EXT_BASE		0x0CD0
+#define RTL8365MB_SVLAN_MC_CONF_EXT_REG(_index) \
+		(RTL8365MB_SVLAN_MC_CONF_EXT_BASE + (_index))
+#define RTL8365MB_SVLAN_MC_CONF_SIZE			64
+#define  RTL8365MB_SVLAN_MC_CONF0_MEMBERS_LS_MASK	GENMASK(7, 0)
+#define  RTL8365MB_SVLAN_MC_CONF0_UNTAG_LS_MASK		GENMASK(15, 8)
+#define  RTL8365MB_SVLAN_MC_CONF1_FID_MASK		GENMASK(3, 0)
+#define  RTL8365MB_SVLAN_MC_CONF1_SPRI_MASK		GENMASK(6, 4)
+#define  RTL8365MB_SVLAN_MC_CONF1_FORCE_FID_MASK	GENMASK(7, 7)
+#define  RTL8365MB_SVLAN_MC_CONF2_SVID_MASK		GENMASK(11, 0)
+#define  RTL8365MB_SVLAN_MC_CONF2_EFIDEN_MASK		GENMASK(12, 12)
+#define  RTL8365MB_SVLAN_MC_CONF2_EFID_MASK		GENMASK(15, 13)
+#define  RTL8365MB_SVLAN_MC_EXT_MEMBERS_MS_MASK		GENMASK(2, 0)
+#define  RTL8365MB_SVLAN_MC_EXT_UNTAG_MS_MASK		GENMASK(5, 3)
+
+/* Shared meters - token buckets usable by VLAN, ACL and storm policers.
+ * Meters 0-31 and 32-63 live in two separate register banks.
+ */
+#define RTL8365MB_NUM_METERS				64
+#define RTL8365MB_METER_BANK_SIZE			32
+#define RTL8365MB_METER_RATE_BASE			0x1600
+#define RTL8365MB_METER32_RATE_BASE			0x1900
+#define RTL8365MB_METER_RATE_REG(_m) \
+		((_m) < RTL8365MB_METER_BANK_SIZE ? \
+		 RTL8365MB_METER_RATE_BASE + ((_m) << 1) : \
+		 RTL8365MB_METER32_RATE_BASE + \
+		 (((_m) - RTL8365MB_METER_BANK_SIZE) << 1))
+#define   RTL8365MB_METER_RATE_CTRL0_MASK		GENMASK(15, 0)
+#define   RTL8365MB_METER_RATE_CTRL1_MASK		GENMASK(2, 0)
+#define RTL8365MB_METER_IFG_BASE			0x1640
+#define RTL8365MB_METER32_IFG_BASE			0x1940
+#define RTL8365MB_METER_IFG_REG(_m) \
+		((_m) < RTL8365MB_METER_BANK_SIZE ? \
+		 RTL8365MB_METER_IFG_BASE + ((_m) >> 4) : \
+		 RTL8365MB_METER32_IFG_BASE + \
+		 (((_m) - RTL8365MB_METER_BANK_SIZE) >> 4))
+#define   RTL8365MB_METER_IFG_MASK(_m)			BIT((_m) & 0xF)
+#define RTL8365MB_METER_BUCKET_SIZE_BASE		0x1660
+#define RTL8365MB_METER32_BUCKET_SIZE_BASE		0x1960
+#define RTL8365MB_METER_BUCKET_SIZE_REG(_m) \
+		((_m) < RTL8365MB_METER_BANK_SIZE ? \
+		 RTL8365MB_METER_BUCKET_SIZE_BASE + (_m) : \
+		 RTL8365MB_METER32_BUCKET_SIZE_BASE + \
+		 ((_m) - RTL8365MB_METER_BANK_SIZE))
+#define   RTL8365MB_METER_BUCKET_SIZE_MASK		GENMASK(15, 0)
+/* Set when the meter drops traffic, write 1 to clear */
+#define RTL8365MB_METER_EXCEED_BASE			0x1680
+#define RTL8365MB_METER32_EXCEED_BASE			0x1980
+#define RTL8365MB_METER_EXCEED_REG(_m) \
+		((_m) < RTL8365MB_METER_BANK_SIZE ? \
+		 RTL8365MB_METER_EXCEED_BASE + ((_m) >> 4) : \
+		 RTL8365MB_METER32_EXCEED_BASE + \
+		 (((_m) - RTL8365MB_METER_BANK_SIZE) >> 4))
+#define   RTL8365MB_METER_EXCEED_MASK(_m)		BIT((_m) & 0xF)
+/* Rate granularity is 8 Kbps, i.e. 1000 bytes per second */
+#define RTL8365MB_METER_RATE_UNIT_BPS			1000
+#define RTL8365MB_METER_RATE_MAX \
+		((FIELD_MAX(RTL8365MB_METER_RATE_CTRL1_MASK) << 16) | \
+		 FIELD_MAX(RTL8365MB_METER_RATE_CTRL0_MASK))
+
+/* Port ingress bandwidth control - the rate takes the same 8 Kbps units as
+ * the meters, the largest rate disables the limit
+ */
+#define RTL8365MB_PORT_INGRESSBW_RATE_BASE		0x000F
+#define RTL8365MB_PORT_INGRESSBW_RATE_REG(_p) \
+		(RTL8365MB_PORT_INGRESSBW_RATE_BASE + ((_p) << 5))
+#define   RTL8365MB_PORT_INGRESSBW_RATE_CTRL0_MASK	GENMASK(15, 0)
+#define   RTL8365MB_PORT_INGRESSBW_RATE_CTRL1_MASK	GENMASK(2, 0)
+#define RTL8365MB_PORT_INGRESSBW_RATE_MAX \
+		((FIELD_MAX(RTL8365MB_PORT_INGRESSBW_RATE_CTRL1_MASK) << 16) | \
+		 FIELD_MAX(RTL8365MB_PORT_INGRESSBW_RATE_CTRL0_MASK))
+
+#define RTL8365MB_PORT_MISC_CFG_BASE			0x000E
+#define RTL8365MB_PORT_MISC_CFG_REG(_p) \
+		(RTL8365MB_PORT_MISC_CFG_BASE + ((_p) << 5))
+/* Count the preamble and interframe gap in the ingress bandwidth */
+#define   RTL8365MB_PORT_MISC_CFG_INGRESSBW_IFG_MASK	BIT(10)
+/* Send pause frames instead of dropping frames beyond the ingress bandwidth */
+#define   RTL8365MB_PORT_MISC_CFG_INGRESSBW_FC_MASK	BIT(11)
+
+/* Port egress bandwidth control - same units and limit as the ingress side */
+#define RTL8365MB_PORT_EGRESSBW_RATE_BASE		0x038C
+#define RTL8365MB_PORT_EGRESSBW_RATE_REG(_p) \
+		(RTL8365MB_PORT_EGRESSBW_RATE_BASE + ((_p) << 1))
+#define   RTL8365MB_PORT_EGRESSBW_RATE_CTRL0_MASK	GENMASK(15, 0)
+#define   RTL8365MB_PORT_EGRESSBW_RATE_CTRL1_MASK	GENMASK(2, 0)
+#define RTL8365MB_PORT_EGRESSBW_RATE_MAX \
+		((FIELD_MAX(RTL8365MB_PORT_EGRESSBW_RATE_CTRL1_MASK) << 16) | \
+		 FIELD_MAX(RTL8365MB_PORT_EGRESSBW_RATE_CTRL0_MASK))
+
+/* Count the preamble and interframe gap in the egress bandwidth of all ports */
+#define RTL8365MB_SCHEDULE_WFQ_CTRL_REG			0x0300
+#define   RTL8365MB_SCHEDULE_WFQ_CTRL_IFG_MASK		BIT(0)
+
+/* Egress queues - each port uses 1 to 8 queues. Internal priorities are
+ * mapped to queues by one table per number of queues, shared by all ports
+ * using that number of queues.
+ */
+#define RTL8365MB_NUM_QUEUES				8
+#define RTL8365MB_QOS_PORT_QUEUE_NUM_BASE		0x0900
+#define RTL8365MB_QOS_PORT_QUEUE_NUM_REG(_p) \
+		(RTL8365MB_QOS_PORT_QUEUE_NUM_BASE + ((_p) >> 2))
+#define   RTL8365MB_QOS_PORT_QUEUE_NUM_OFFSET(_p)	(((_p) & 3) << 2)
+#define   RTL8365MB_QOS_PORT_QUEUE_NUM_MASK(_p) \
+		(0x7 << RTL8365MB_QOS_PORT_QUEUE_NUM_OFFSET(_p))
+#define RTL8365MB_QOS_PRI_TO_QID_BASE			0x0904
+#define RTL8365MB_QOS_PRI_TO_QID_REG(_n, _pri) \
+		(RTL8365MB_QOS_PRI_TO_QID_BASE + (((_n) - 1) << 1) + ((_pri) >> 2))
+#define   RTL8365MB_QOS_PRI_TO_QID_OFFSET(_pri)	(((_pri) & 3) << 2)
+#define   RTL8365MB_QOS_PRI_TO_QID_MASK(_pri) \
+		(0x7 << RTL8365MB_QOS_PRI_TO_QID_OFFSET(_pri))
+
+/* Egress scheduling - strict priority queues are served first, higher queues
+ * before lower ones, then the remaining queues share the bandwidth by weight
+ */
+#define RTL8365MB_SCHEDULE_QUEUE_TYPE_BASE		0x0302
+#define RTL8365MB_SCHEDULE_QUEUE_TYPE_REG(_p) \
+		(RTL8365MB_SCHEDULE_QUEUE_TYPE_BASE + ((_p) >> 1))
+#define   RTL8365MB_SCHEDULE_QUEUE_TYPE_STRICT_MASK(_p, _q) \
+		BIT((((_p) & 1) << 3) + (_q))
+#define RTL8365MB_SCHEDULE_WFQ_WEIGHT_BASE		0x030C
+#define RTL8365MB_SCHEDULE_WFQ_WEIGHT_REG(_p, _q) \
+		(RTL8365MB_SCHEDULE_WFQ_WEIGHT_BASE + ((_p) << 3) + (_q))
+#define   RTL8365MB_SCHEDULE_WFQ_WEIGHT_MASK		GENMASK(6, 0)
+
+/* Storm control - flooded traffic of each class entering a port can be
+ * policed by a meter of its own
+ */
+#define RTL8365MB_STORM_ENABLE_BASE			0x08B0
+#define RTL8365MB_STORM_ENABLE_REG(_c)	(RTL8365MB_STORM_ENABLE_BASE + (_c))
+#define RTL8365MB_STORM_METER_BASE			0x08D0
+#define RTL8365MB_STORM_METER_REG(_c, _p) \
+		(RTL8365MB_STORM_METER_BASE + ((_c) * 6) + ((_p) >> 1))
+#define   RTL8365MB_STORM_METER_OFFSET(_p)		(((_p) & 1) << 3)
+#define   RTL8365MB_STORM_METER_MASK(_p) \
+		(0x3F << RTL8365MB_STORM_METER_OFFSET(_p))
+
+enum rtl8365mb_storm {
+	RTL8365MB_STORM_BCAST = 0,
+	RTL8365MB_STORM_MCAST,
+	RTL8365MB_STORM_UNKNOWN_MCAST,
+	RTL8365MB_STORM_UNKNOWN_UCAST,
+	RTL8365MB_STORM_END,
+};
+
+/* Priority extraction - the internal priority of a frame is taken from the
+ * priority source with the highest weight that applies to the frame. Every
+ * frame has a port-based priority, so sources weighted below it are never
+ * used. Ports pick one of two weight tables.
+ */
+#define RTL8365MB_QOS_1Q_PRI_REMAP_BASE			0x0865
+#define RTL8365MB_QOS_1Q_PRI_REMAP_REG(_pcp) \
+		(RTL8365MB_QOS_1Q_PRI_REMAP_BASE + ((_pcp) >> 2))
+#define   RTL8365MB_QOS_1Q_PRI_REMAP_OFFSET(_pcp)	(((_pcp) & 3) << 2)
+#define   RTL8365MB_QOS_1Q_PRI_REMAP_MASK(_pcp) \
+		(0x7 << RTL8365MB_QOS_1Q_PRI_REMAP_OFFSET(_pcp))
+#define RTL8365MB_QOS_PORT_PRI_BASE			0x0870
+#define RTL8365MB_QOS_PORT_PRI_REG(_p) \
+		(RTL8365MB_QOS_PORT_PRI_BASE + ((_p) >> 2))
+#define   RTL8365MB_QOS_PORT_PRI_OFFSET(_p)		(((_p) & 3) << 2)
+#define   RTL8365MB_QOS_PORT_PRI_MASK(_p) \
+		(0x7 << RTL8365MB_QOS_PORT_PRI_OFFSET(_p))
+#define RTL8365MB_NUM_DSCP				64
+#define RTL8365MB_QOS_DSCP_PRI_BASE			0x0878
+#define RTL8365MB_QOS_DSCP_PRI_REG(_dscp) \
+		(RTL8365MB_QOS_DSCP_PRI_BASE + ((_dscp) >> 2))
+#define   RTL8365MB_QOS_DSCP_PRI_OFFSET(_dscp)		(((_dscp) & 3) << 2)
+#define   RTL8365MB_QOS_DSCP_PRI_MASK(_dscp) \
+		(0x7 << RTL8365MB_QOS_DSCP_PRI_OFFSET(_dscp))
+#define RTL8365MB_QOS_PRI_DECISION_BASE			0x0888
+#define RTL8365MB_QOS_PRI_DECISION_REG(_t, _src) \
+		(RTL8365MB_QOS_PRI_DECISION_BASE + ((_t) << 1) + ((_src) >> 2))
+#define   RTL8365MB_QOS_PRI_DECISION_OFFSET(_src)	(((_src) & 3) << 2)
+#define   RTL8365MB_QOS_PRI_DECISION_MASK(_src) \
+		(0x7 << RTL8365MB_QOS_PRI_DECISION_OFFSET(_src))
+#define RTL8365MB_QOS_PRI_DECISION_IDX_REG		0x088C
+#define RTL8365MB_NUM_PRI_DECISIONS			2
+
+enum rtl8365mb_pri_src {
+	RTL8365MB_PRI_SRC_PORT = 0,
+	RTL8365MB_PRI_SRC_ACL,
+	RTL8365MB_PRI_SRC_DSCP,
+	RTL8365MB_PRI_SRC_1Q,
+	RTL8365MB_PRI_SRC_SVLAN,
+	RTL8365MB_PRI_SRC_CVLAN,
+	RTL8365MB_PRI_SRC_DMAC,
+	RTL8365MB_PRI_SRC_SMAC,
+	RTL8365MB_PRI_SRC_END,
+};
+
+/* ACL engine - rules match up to 8 16-bit fields selected by one of 5
+ * templates. Rules are looked up in index order and the first hit applies
+ * the actions of its action entry. The data and care bits of a rule are
+ * separate entries of the ACL rule table.
+ */
+#define RTL8365MB_NUM_ACL_RULES				96
+#define RTL8365MB_NUM_ACL_TEMPLATES			5
+#define RTL8365MB_ACL_NUM_FIELDS			8
+#define RTL8365MB_ACL_RULE_ENTRY_SIZE			10
+#define RTL8365MB_ACL_ACT_ENTRY_SIZE			4
+#define RTL8365MB_ACL_RULE_ADDR(_r, _care) \
+		((_r) < 64 ? ((_care) << 6) | (_r) : \
+		 ((_care) << 5) | ((_r) + 64))
+#define  RTL8365MB_ACL_RULE_CONF0_TYPE_MASK		GENMASK(2, 0)
+#define  RTL8365MB_ACL_RULE_CONF0_TAG_EXIST_MASK	GENMASK(7, 3)
+#define  RTL8365MB_ACL_RULE_CONF0_PMSK_LS_MASK		GENMASK(15, 8)
+#define  RTL8365MB_ACL_RULE_CONF9_PMSK_MS_MASK		GENMASK(2, 0)
+#define  RTL8365MB_ACL_RULE_CONF9_VALID_MASK		GENMASK(3, 3)
+
+/* Headers found in the frame, matched through the tag exist bits */
+#define RTL8365MB_ACL_TAG_CTAG				BIT(0)
+#define RTL8365MB_ACL_TAG_STAG				BIT(1)
+#define RTL8365MB_ACL_TAG_PPPOE				BIT(2)
+#define RTL8365MB_ACL_TAG_IPV4				BIT(3)
+#define RTL8365MB_ACL_TAG_IPV6				BIT(4)
+
+#define  RTL8365MB_ACL_ACT_CONF1_METER_IDX_MASK		GENMASK(7, 2)
+#define  RTL8365MB_ACL_ACT_CONF1_FWD_PMSK_LS_MASK	GENMASK(15, 8)
+#define  RTL8365MB_ACL_ACT_CONF2_FWD_ACT_MASK		GENMASK(1, 0)
+#define  RTL8365MB_ACL_ACT_CONF2_PRI_MASK		GENMASK(7, 2)
+#define  RTL8365MB_ACL_ACT_CONF2_PRI_ACT_MASK		GENMASK(9, 8)
+#define  RTL8365MB_ACL_ACT_CONF3_FWD_PMSK_MS_MASK	GENMASK(7, 5)
+
+enum rtl8365mb_acl_fwd_act {
+	RTL8365MB_ACL_FWD_COPY = 0,
+	RTL8365MB_ACL_FWD_REDIRECT,
+	RTL8365MB_ACL_FWD_MIRROR,
+	RTL8365MB_ACL_FWD_TRAP,
+};
+
+/* Assign the internal priority */
+#define RTL8365MB_ACL_PRI_ACT_INTERNAL			0
+
+/* Control plane protection - classes of control traffic, each policed at
+ * ingress of every user port by ACL rules sharing a meter. This is a
+ * dataplane limit: frames of the class forwarded between user ports count
+ * against the rate as much as those headed for the CPU.
+ */
+#define RTL8365MB_COPP_MAX_MATCHES	3
+
+enum rtl8365mb_copp {
+	RTL8365MB_COPP_ARP = 0,
+	RTL8365MB_COPP_IGMP,
+	RTL8365MB_COPP_NDISC,
+	RTL8365MB_COPP_LINK_LOCAL,
+	RTL8365MB_COPP_END,
+};
+
+/* Template control registers - two field types per register */
+#define RTL8365MB_ACL_TEMPLATE_CTRL_BASE		0x0600
+#define RTL8365MB_ACL_TEMPLATE_CTRL_REG(_t, _f) \
+		(RTL8365MB_ACL_TEMPLATE_CTRL_BASE + ((_t) << 2) + ((_f) >> 1))
+#define   RTL8365MB_ACL_TEMPLATE_CTRL_FIELD_EVEN_MASK	GENMASK(7, 0)
+#define   RTL8365MB_ACL_TEMPLATE_CTRL_FIELD_ODD_MASK	GENMASK(15, 8)
+
+/* Action control registers - enabled actions of two rules per register */
+#define RTL8365MB_ACL_ACTION_CTRL_BASE			0x0614
+#define RTL8365MB_ACL_ACTION_CTRL2_BASE			0x06F0
+#define RTL8365MB_ACL_ACTION_CTRL_REG(_r) \
+		((_r) < 64 ? RTL8365MB_ACL_ACTION_CTRL_BASE + ((_r) >> 1) : \
+		 RTL8365MB_ACL_ACTION_CTRL2_BASE + (((_r) - 64) >> 1))
+#define   RTL8365MB_ACL_ACTION_CTRL_MASK(_r) \
+		((_r) & 1 ? GENMASK(15, 8) : GENMASK(7, 0))
+#define   RTL8365MB_ACL_ACTION_CVLAN			BIT(0)
+#define   RTL8365MB_ACL_ACTION_SVLAN			BIT(1)
+#define   RTL8365MB_ACL_ACTION_PRIORITY			BIT(2)
+#define   RTL8365MB_ACL_ACTION_POLICING			BIT(3)
+#define   RTL8365MB_ACL_ACTION_FORWARD			BIT(4)
+#define   RTL8365MB_ACL_ACTION_INTERRUPT		BIT(5)
+/* Like POLICING, but the meter index selects a log counter pair */
+#define   RTL8365MB_ACL_ACTION_LOGGING			BIT(6)
+
+/* Ports looking up the ACL, and ports permitting frames matching no rule */
+#define RTL8365MB_ACL_ENABLE_REG			0x06D5
+#define RTL8365MB_ACL_UNMATCH_PERMIT_REG		0x06D6
+#define   RTL8365MB_ACL_PORTMASK_MASK			GENMASK(10, 0)
+
+/* Field selectors - user defined fields at an offset from a header */
+#define RTL8365MB_ACL_NUM_FIELD_SELS			16
+#define RTL8365MB_ACL_FIELD_SEL_BASE			0x12E7
+#define RTL8365MB_ACL_FIELD_SEL_REG(_n) \
+		(RTL8365MB_ACL_FIELD_SEL_BASE + (_n))
+#define   RTL8365MB_ACL_FIELD_SEL_OFFSET_MASK		GENMASK(7, 0)
+#define   RTL8365MB_ACL_FIELD_SEL_FORMAT_MASK		GENMASK(10, 8)
+
+enum rtl8365mb_acl_field_sel_format {
+	RTL8365MB_ACL_FIELD_SEL_FORMAT_DEFAULT = 0,
+	RTL8365MB_ACL_FIELD_SEL_FORMAT_RAW,
+	RTL8365MB_ACL_FIELD_SEL_FORMAT_LLC,
+	RTL8365MB_ACL_FIELD_SEL_FORMAT_IPV4,
+	RTL8365MB_ACL_FIELD_SEL_FORMAT_ARP,
+	RTL8365MB_ACL_FIELD_SEL_FORMAT_IPV6,
+	RTL8365MB_ACL_FIELD_SEL_FORMAT_IP_PAYLOAD,
+	RTL8365MB_ACL_FIELD_SEL_FORMAT_L4,
+};
+
+/* Field selectors used by the driver */
+enum rtl8365mb_acl_field_sel {
+	/* Bits 127-32 of the IPv6 addresses, the rest has dedicated fields */
+	RTL8365MB_ACL_SEL_IP6_SIP = 0,
+	RTL8365MB_ACL_SEL_IP6_DIP = 6,
+	RTL8365MB_ACL_SEL_IP4_PROTO = 12,
+	RTL8365MB_ACL_SEL_L4_SPORT,
+	RTL8365MB_ACL_SEL_L4_DPORT,
+	RTL8365MB_ACL_SEL_IP6_NEXTHDR,
+};
+
+/* Field types of the templates */
+enum rtl8365mb_acl_field {
+	RTL8365MB_ACL_FIELD_UNUSED = 0x00,
+	RTL8365MB_ACL_FIELD_DMAC0 = 0x01,
+	RTL8365MB_ACL_FIELD_DMAC1 = 0x02,
+	RTL8365MB_ACL_FIELD_DMAC2 = 0x03,
+	RTL8365MB_ACL_FIELD_SMAC0 = 0x04,
+	RTL8365MB_ACL_FIELD_SMAC1 = 0x05,
+	RTL8365MB_ACL_FIELD_SMAC2 = 0x06,
+	RTL8365MB_ACL_FIELD_ETHERTYPE = 0x07,
+	RTL8365MB_ACL_FIELD_STAG = 0x08,
+	RTL8365MB_ACL_FIELD_CTAG = 0x09,
+	RTL8365MB_ACL_FIELD_IP4SIP0 = 0x10,
+	RTL8365MB_ACL_FIELD_IP4SIP1 = 0x11,
+	RTL8365MB_ACL_FIELD_IP4DIP0 = 0x12,
+	RTL8365MB_ACL_FIELD_IP4DIP1 = 0x13,
+	RTL8365MB_ACL_FIELD_IP6SIP0 = 0x20,
+	RTL8365MB_ACL_FIELD_IP6SIP1 = 0x21,
+	RTL8365MB_ACL_FIELD_IP6DIP0 = 0x28,
+	RTL8365MB_ACL_FIELD_IP6DIP1 = 0x29,
+	RTL8365MB_ACL_FIELD_SEL0 = 0x40,
+};
+
+#define RTL8365MB_ACL_FIELD_SEL(_n)	(RTL8365MB_ACL_FIELD_SEL0 + (_n))
+
+/* L2 lookup table entries - a 2K hash table followed by a 64 entry CAM */
+#define RTL8365MB_L2_ENTRY_SIZE				6 /* 96-bits */
+#define RTL8365MB_L2_HASH_SIZE				2048
+#define RTL8365MB_L2_CAM_SIZE				64
+#define RTL8365MB_L2_SIZE \
+		(RTL8365MB_L2_HASH_SIZE + RTL8365MB_L2_CAM_SIZE)
+#define RTL8365MB_L2_INDEX_BITS			8
+/* Scanning for hardware learned addresses */
+#define RTL8365MB_L2_SCAN_INTERVAL_JIFFIES		HZ
+#define RTL8365MB_L2_SCAN_BUDGET			128
+#define RTL8365MB_L2_SCAN_NOTIFY_BUDGET			32
+/* MAC address, most significant byte first in the highest word */
+#define  RTL8365MB_L2_CONF0_MAC5_MASK			GENMASK(7, 0)
+#define  RTL8365MB_L2_CONF0_MAC4_MASK			GENMASK(15, 8)
+#define  RTL8365MB_L2_CONF1_MAC3_MASK			GENMASK(7, 0)
+#define  RTL8365MB_L2_CONF1_MAC2_MASK			GENMASK(15, 8)
+#define  RTL8365MB_L2_CONF2_MAC1_MASK			GENMASK(7, 0)
+#define  RTL8365MB_L2_CONF2_MAC0_MASK			GENMASK(15, 8)
+/* VID for independent, FID for shared VLAN learning */
+#define  RTL8365MB_L2_CONF3_VID_FID_MASK		GENMASK(11, 0)
+#define  RTL8365MB_L2_CONF3_L3LOOKUP_MASK		GENMASK(12, 12)
+#define  RTL8365MB_L2_CONF3_IVL_SVL_MASK		GENMASK(13, 13)
+#define  RTL8365MB_L2_UC_CONF3_SPA_MS_MASK		GENMASK(15, 15)
+#define  RTL8365MB_L2_UC_CONF4_EFID_MASK		GENMASK(2, 0)
+#define  RTL8365MB_L2_UC_CONF4_FID_MASK			GENMASK(6, 3)
+#define  RTL8365MB_L2_UC_CONF4_SA_EN_MASK		GENMASK(7, 7)
+#define  RTL8365MB_L2_UC_CONF4_SPA_LS_MASK		GENMASK(10, 8)
+#define  RTL8365MB_L2_UC_CONF4_AGE_MASK			GENMASK(13, 11)
+#define  RTL8365MB_L2_UC_CONF4_AUTH_MASK		GENMASK(14, 14)
+#define  RTL8365MB_L2_UC_CONF4_SA_BLOCK_MASK		GENMASK(15, 15)
+#define  RTL8365MB_L2_UC_CONF5_LUT_PRI_MASK		GENMASK(3, 1)
+#define  RTL8365MB_L2_UC_CONF5_FWD_EN_MASK		GENMASK(4, 4)
+#define  RTL8365MB_L2_UC_CONF5_DA_BLOCK_MASK		GENMASK(5, 5)
+/* Static entry, neither aged out nor overwritten by learning */
+#define  RTL8365MB_L2_UC_CONF5_NOSALEARN_MASK		GENMASK(6, 6)
+#define  RTL8365MB_L2_MC_CONF3_MBR_MID_MASK		GENMASK(15, 14)
+#define  RTL8365MB_L2_MC_CONF4_MBR_LS_MASK		GENMASK(7, 0)
+#define  RTL8365MB_L2_MC_CONF4_IGMPIDX_MASK		GENMASK(15, 8)
+#define  RTL8365MB_L2_MC_CONF5_IGMP_ASIC_MASK		GENMASK(0, 0)
+#define  RTL8365MB_L2_MC_CONF5_LUT_PRI_MASK		GENMASK(3, 1)
+#define  RTL8365MB_L2_MC_CONF5_FWD_EN_MASK		GENMASK(4, 4)
+#define  RTL8365MB_L2_MC_CONF5_NOSALEARN_MASK		GENMASK(5, 5)
+#define  RTL8365MB_L2_MC_CONF5_MBR_MS_MASK		GENMASK(7, 7)
+
+enum rtl8365mb_l2_flush_mode {
+	RTL8365MB_L2_FLUSH_MODE_PORT = 0,
+	RTL8365MB_L2_FLUSH_MODE_PORT_VID,
+	RTL8365MB_L2_FLUSH_MODE_PORT_FID,
+};
+
+/* Methods of L2 table read commands, in the TABLE_CONTROL_METHOD field */
+enum rtl8365mb_l2_method {
+	RTL8365MB_L2_METHOD_MAC = 0,
+	RTL8365MB_L2_METHOD_ADDR,
+	RTL8365MB_L2_METHOD_NEXT_ADDR,
+	RTL8365MB_L2_METHOD_NEXT_UC,
+	RTL8365MB_L2_METHOD_NEXT_MC,
+	RTL8365MB_L2_METHOD_NEXT_L3MC,
+	RTL8365MB_L2_METHOD_NEXT_L2L3MC,
+	RTL8365MB_L2_METHOD_NEXT_UC_SPA,
+};
+
 enum rtl8365mb_table {
 	RTL8365MB_TABLE_ACL_RULE = 1,
 	RTL8365MB_TABLE_ACL_ACT,
@@ -410,14 +918,40 @@ enum rtl8365mb_table_op {
 	RTL8365MB_TABLE_WRITE
 };
 
-static const int rtl8365mb_table_entry_size[] = {
-	[RTL8365MB_TABLE_ACL_RULE] = 0,
-	[RTL8365MB_TABLE_ACL_ACT] = 0,
-	[RTL8365MB_TABLE_CVLAN] = 3,
-	[RTL8365MB_TABLE_L2] = 0,
-	[RTL8365MB_TABLE_IGMP_GROUP] = 0
+#define RTL8365MB_TABLE_CMD(_table, _op) \
+		(FIELD_PREP_CONST(RTL8365MB_TABLE_CONTROL_TABLE_MASK, (_table)) | \
+		 FIELD_PREP_CONST(RTL8365MB_TABLE_CONTROL_COMMAND_MASK, (_op)))
+
+#define RTL8365MB_TABLE_DESC(_table, _size, _last_word_mask) \
+	[_table] = { \
+		.ctrl_reg = RTL8365MB_TABLE_CONTROL_REG, \
+		.addr_reg = RTL8365MB_TABLE_ACCESS_ADDR_REG, \
+		.addr_mask = RTL8365MB_TABLE_ACCESS_ADDR_REG_MASK, \
+		.busy_reg = RTL8365MB_TABLE_LUT_REG, \
+		.busy_mask = RTL8365MB_TABLE_LUT_BUSY_FLAG_MASK, \
+		.wdata_reg = RTL8365MB_TABLE_WRITE_DATA_REG_BASE, \
+		.rdata_reg = RTL8365MB_TABLE_READ_DATA_REG_BASE, \
+		.entry_size = (_size), \
+		.last_word_mask = (_last_word_mask), \
+		.cmd_read = RTL8365MB_TABLE_CMD(_table, RTL8365MB_TABLE_READ), \
+		.cmd_write = RTL8365MB_TABLE_CMD(_table, RTL8365MB_TABLE_WRITE), \
+	}
+
+/* All tables share the same access engine. The IGMP group table layout is not
+ * known, so it is left unsupported.
+ */
+static const struct rtl83xx_table_desc rtl8365mb_tables[] = {
+	RTL8365MB_TABLE_DESC(RTL8365MB_TABLE_ACL_RULE, 10,
+			     RTL8365MB_TABLE_10TH_DATA_REG_MASK),
+	RTL8365MB_TABLE_DESC(RTL8365MB_TABLE_ACL_ACT, 4, 0),
+	RTL8365MB_TABLE_DESC(RTL8365MB_TABLE_CVLAN,
+			     RTL8365MB_VLAN_4K_ENTRY_SIZE, 0),
+	RTL8365MB_TABLE_DESC(RTL8365MB_TABLE_L2, RTL8365MB_L2_ENTRY_SIZE, 0),
+	RTL8365MB_TABLE_DESC(RTL8365MB_TABLE_IGMP_GROUP, 0, 0),
 };
 
+static_assert(ARRAY_SIZE(rtl8365mb_tables) == RTL8365MB_NUM_TABLES);
+
 enum rtl8365mb_frame_type {
 	RTL8365MB_FRAME_TYPE_ANY_FRAME = 0,
 	RTL8365MB_FRAME_TYPE_TAGGED_ONLY,
@@ -724,17 +1258,265 @@ struct rtl8365mb_cpu {
  * struct rtl8365mb_port - private per-port data
  * @priv: pointer to parent realtek_priv data
  * @index: DSA port index, same as dsa_port::index
+ * @fid: filtering database of the port, either its own while standalone or
+ *       the one of its bridge
+ * @svidx: SVLAN member configuration assigned to frames received without an
+ *         S-tag, zero if none
  * @stats: link statistics populated by rtl8365mb_stats_poll, ready for atomic
  *         access via rtl8365mb_get_stats64
- * @stats_lock: protect the stats structure during read/update
+ * @stats_lock: protect the stats structure, @learn_over, @storm_exceed and
+ *              @copp_exceed during read/update
  * @mib_work: delayed work for polling MIB counters
+ * @learning: learning is enabled on the port
+ * @learn_over: number of learning limit overflow events signalled by the
+ *              switch
+ * @num_queues: number of egress queues in use, protected by RTNL
+ * @pri_decision: priority decision table used by the port, protected by RTNL
+ * @storm_meter: meter policing each storm control class, or -1
+ * @storm_exceed: number of storm control exceed events signalled by the
+ *                switch
+ * @copp_meter: meter policing each control plane protection class, or -1
+ * @copp_rules: ACL rules policing each control plane protection class on
+ *              the port, protected by rtl8365mb::acl_lock
+ * @copp_exceed: number of meter exceed interrupts signalled for each control
+ *               plane protection class. The interrupt is held off for
+ *               RTL8365MB_STORM_IRQ_HOLDOFF_JIFFIES once signalled, so this
+ *               counts intervals with excess traffic, not dropped frames,
+ *               and stays at zero when the switch has no interrupt line.
  */
 struct rtl8365mb_port {
 	struct realtek_priv *priv;
 	unsigned int index;
+	u8 fid;
+	u8 svidx;
 	struct rtnl_link_stats64 stats;
 	spinlock_t stats_lock;
 	struct delayed_work mib_work;
+	bool learning;
+	u64 learn_over;
+	u8 num_queues;
+	u8 pri_decision;
+	int storm_meter[RTL8365MB_STORM_END];
+	u64 storm_exceed;
+	int copp_meter[RTL8365MB_COPP_END];
+	struct rtl8365mb_acl_rule *copp_rules[RTL8365MB_COPP_END]
+					     [RTL8365MB_COPP_MAX_MATCHES];
+	u64 copp_exceed[RTL8365MB_COPP_END];
+};
+
+/**
+ * struct rtl8365mb_pri_decision - priority decision table
+ * @sel: trusted DCB app selectors, in order of precedence
+ * @nsel: number of trusted selectors
+ * @ports: user ports using the table
+ */
+struct rtl8365mb_pri_decision {
+	u8 sel[2];
+	int nsel;
+	u32 ports;
+};
+
+/**
+ * struct rtl8365mb_queue_map - internal priority to queue mapping
+ * @qid: queue of each internal priority
+ * @refcount: number of ports with an offloaded ets qdisc using the mapping
+ */
+struct rtl8365mb_queue_map {
+	u8 qid[RTL8365MB_NUM_PRIORITIES];
+	unsigned int refcount;
+};
+
+/**
+ * struct rtl8365mb_svlan - SVLAN member configuration
+ * @svid: S-VLAN ID, zero when the entry is free
+ * @member: member ports
+ * @untag: member ports sending frames of this S-VLAN without an S-tag
+ */
+struct rtl8365mb_svlan {
+	u16 svid;
+	u16 member;
+	u16 untag;
+};
+
+/**
+ * struct rtl8365mb_meter - shared meter bookkeeping
+ * @refcount: number of users of the meter, zero when the meter is free
+ * @rate: programmed rate in bytes per second
+ * @burst: programmed bucket size in bytes
+ */
+struct rtl8365mb_meter {
+	unsigned int refcount;
+	u64 rate;
+	u32 burst;
+};
+
+/**
+ * struct rtl8365mb_acl_rule - ACL rule compiled from a flower rule or
+ *                            installed for control plane protection
+ * @index: ACL rule and action entry holding the rule
+ * @prio: flower rule priority, rules with lower values are looked up first
+ * @pmask: ingress ports matched by the rule
+ * @police_index: index of the tc police action of a policing flower rule
+ * @data: data bits of the rule entry
+ * @care: care bits of the rule entry
+ * @act: action entry
+ * @act_ctrl: enabled actions, RTL8365MB_ACL_ACTION_*
+ * @meter: meter of a police action, or -1
+ * @counter: log counter pair counting the hits of the rule, or -1
+ */
+struct rtl8365mb_acl_rule {
+	int index;
+	u32 prio;
+	u32 pmask;
+	u32 police_index;
+	u16 data[RTL8365MB_ACL_RULE_ENTRY_SIZE];
+	u16 care[RTL8365MB_ACL_RULE_ENTRY_SIZE];
+	u16 act[RTL8365MB_ACL_ACT_ENTRY_SIZE];
+	u8 act_ctrl;
+	int meter;
+	int counter;
+};
+
+/**
+ * struct rtl8365mb_acl_counter - ACL log counter pair
+ * @used: the pair is counting the hits of an ACL rule
+ * @hw_packets: packet counter value at the last poll
+ * @hw_bytes: byte counter value at the last poll
+ * @packets: packets counted since the pair was allocated
+ * @bytes: bytes counted since the pair was allocated
+ * @reported_packets: @packets at the last stats query
+ * @reported_bytes: @bytes at the last stats query
+ * @lastused: jiffies at the last poll seeing the packet counter move
+ */
+struct rtl8365mb_acl_counter {
+	bool used;
+	u32 hw_packets;
+	u32 hw_bytes;
+	u64 packets;
+	u64 bytes;
+	u64 reported_packets;
+	u64 reported_bytes;
+	unsigned long lastused;
+};
+
+enum rtl8365mb_devlink_resource_id {
+	RTL8365MB_RESOURCE_ID_ACL_RULES,
+};
+
+enum rtl8365mb_devlink_param_id {
+	RTL8365MB_DEVLINK_PARAM_ID_BASE = DEVLINK_PARAM_GENERIC_ID_MAX,
+	RTL8365MB_DEVLINK_PARAM_ID_STORM_BCAST,
+	RTL8365MB_DEVLINK_PARAM_ID_STORM_MCAST,
+	RTL8365MB_DEVLINK_PARAM_ID_STORM_UNKNOWN_MCAST,
+	RTL8365MB_DEVLINK_PARAM_ID_STORM_UNKNOWN_UCAST,
+	RTL8365MB_DEVLINK_PARAM_ID_COPP_ARP,
+	RTL8365MB_DEVLINK_PARAM_ID_COPP_IGMP,
+	RTL8365MB_DEVLINK_PARAM_ID_COPP_NDISC,
+	RTL8365MB_DEVLINK_PARAM_ID_COPP_LINK_LOCAL,
+	RTL8365MB_DEVLINK_PARAM_ID_LEARNING_LIMIT,
+	RTL8365MB_DEVLINK_PARAM_ID_LEARNING_OVERFLOW_ACTION,
+};
+
+/**
+ * struct rtl8365mb_flower_rule - offloaded flower rule
+ * @list: node in rtl8365mb::flower_rules
+ * @cookie: flower rule cookie
+ * @port: port the rule was installed on
+ * @acl: ACL rule programmed for this rule
+ */
+struct rtl8365mb_flower_rule {
+	struct list_head list;
+	unsigned long cookie;
+	int port;
+	struct rtl8365mb_acl_rule *acl;
+};
+
+/**
+ * struct rtl8365mb_l2_uc - unicast L2 table entry
+ * @mac: MAC address
+ * @fid: filtering database the address belongs to
+ * @port: source port of the address
+ * @age: remaining age, zero for invalid entries
+ * @is_static: the entry is neither aged out nor moved by learning
+ */
+struct rtl8365mb_l2_uc {
+	u8 mac[ETH_ALEN];
+	u16 fid;
+	int port;
+	u8 age;
+	bool is_static;
+};
+
+/**
+ * struct rtl8365mb_l2_index_entry - L2 table entry installed by the driver
+ * @node: node in rtl8365mb::l2_index
+ * @mac: MAC address
+ * @fid: filtering database the address belongs to
+ * @port: port the address is installed on
+ * @addr: address of the entry in the L2 table
+ * @vids: VLANs of the FDB entries of @port mapping to this L2 table entry
+ * @num_vids: number of VLANs in @vids
+ *
+ * With shared VLAN learning, the FDB entries of an address in several VLANs
+ * of a bridge all map to the same L2 table entry. The bridge may add an FDB
+ * entry again when it is refreshed or replaced, so the VLANs are kept as a
+ * set rather than counted.
+ */
+struct rtl8365mb_l2_index_entry {
+	struct hlist_node node;
+	u8 mac[ETH_ALEN];
+	u16 fid;
+	int port;
+	u32 addr;
+	u16 *vids;
+	unsigned int num_vids;
+};
+
+/**
+ * struct rtl8365mb_l2_mc_group - multicast L2 table entry
+ * @node: node in rtl8365mb::l2_mc
+ * @mac: group MAC address
+ * @fid: filtering database the group belongs to
+ * @refcount: number of MDB entries of the group, per member port
+ *
+ * With shared VLAN learning, the MDB entries of a group in several VLANs of
+ * a bridge all map to the same L2 table entry.
+ */
+struct rtl8365mb_l2_mc_group {
+	struct hlist_node node;
+	u8 mac[ETH_ALEN];
+	u16 fid;
+	unsigned int refcount[RTL8365MB_MAX_NUM_PORTS];
+};
+
+/**
+ * struct rtl8365mb_l2_learned - hardware learned address known to the bridge
+ * @node: node in rtl8365mb::l2_learned
+ * @mac: MAC address
+ * @fid: filtering database the address belongs to
+ * @port: port the address was learned on
+ * @gen: scan generation the address was last seen in
+ */
+struct rtl8365mb_l2_learned {
+	struct hlist_node node;
+	u8 mac[ETH_ALEN];
+	u16 fid;
+	int port;
+	unsigned int gen;
+};
+
+/**
+ * struct rtl8365mb_l2_event - bridge FDB notification found by the scan
+ * @list: node in rtl8365mb::l2_events
+ * @type: SWITCHDEV_FDB_ADD_TO_BRIDGE or SWITCHDEV_FDB_DEL_TO_BRIDGE
+ * @port: port the address was learned on
+ * @mac: MAC address
+ */
+struct rtl8365mb_l2_event {
+	struct list_head list;
+	unsigned long type;
+	int port;
+	u8 mac[ETH_ALEN];
 };
 
 /**
@@ -744,7 +1526,51 @@ struct rtl8365mb_port {
  * @chip_info: chip-specific info about the attached switch
  * @cpu: CPU tagging and CPU port configuration for this chip
  * @mib_lock: prevent concurrent reads of MIB counters
- * @table_lock: prevent concurrent reads of tables
+ * @table_lock: serialize read-modify-write sequences on VLAN tables
+ * @fid_map: FIDs in use, protected by RTNL
+ * @bridge_fid: FID of each offloaded bridge, indexed by dsa_bridge::num
+ * @svlan: image of the SVLAN member configurations, protected by @table_lock
+ * @svlan_uplink: ports sending S-tagged frames, protected by @table_lock
+ * @meter_lock: protect the shared meter allocation
+ * @meters: shared meter bookkeeping, protected by @meter_lock
+ * @acl_lock: serialize updates of the ACL and the flower rules
+ * @flower_rules: list of offloaded flower rules, protected by @acl_lock
+ * @acl_rules: ACL rule of each ACL entry, NULL if free, protected by
+ *             @acl_lock
+ * @acl_counter_lock: protect the ACL log counter bookkeeping
+ * @acl_counters: ACL log counter pairs, protected by @acl_counter_lock
+ * @acl_stats_work: delayed work polling the ACL log counters in use
+ * @l2_lock: serialize lookup and update sequences on the L2 table
+ * @l2_index: static L2 table entries installed by the driver, indexed by
+ *            MAC address and FID, protected by @l2_lock
+ * @l2_mc: multicast L2 table entries, protected by @l2_lock
+ * @l2_learned: hardware learned addresses reported to the bridge, protected
+ *              by @l2_lock
+ * @l2_scan_cursor: L2 table address the next scan run starts from
+ * @l2_scan_gen: generation of the current full scan pass
+ * @l2_scan_work: delayed work scanning the L2 table for learned addresses
+ * @l2_events: bridge notifications found by the scan and not sent yet,
+ *             protected by @l2_lock
+ * @host_flood_uc: user ports needing flooded unknown unicast at the host
+ * @host_flood_mc: user ports needing flooded unknown multicast at the host
+ * @learn_limit: number of L2 addresses each port may learn while learning is
+ *               enabled, protected by RTNL
+ * @learn_over_act: action on frames exceeding the learning limit of a port,
+ *                  protected by RTNL
+ * @isolation: committed port isolation matrix, indexed by port, protected by
+ *             RTNL
+ * @isolated: bridged ports with BR_ISOLATED set, protected by RTNL
+ * @queue_maps: internal priority to queue mappings, indexed by the number of
+ *              queues minus one, protected by RTNL
+ * @pri_decisions: priority decision tables, protected by RTNL
+ * @dscp_prio: internal priority of each DSCP, protected by RTNL
+ * @dscp_ports: ports with a DCB app entry for each DSCP, protected by RTNL
+ * @storm_kbps: storm control rate of each class, zero if disabled
+ * @storm_work: delayed work unmasking the meter exceed interrupt
+ * @storm_stopped: set when the IRQ is torn down, the meter exceed interrupt
+ *                 is then left masked
+ * @copp_kbps: control plane protection rate of each class, zero if disabled,
+ *             protected by @acl_lock
  * @ports: per-port data
  *
  * Private data for this driver.
@@ -756,6 +1582,40 @@ struct rtl8365mb {
 	struct rtl8365mb_cpu cpu;
 	struct mutex mib_lock;
 	struct mutex table_lock;
+	DECLARE_BITMAP(fid_map, RTL8365MB_NUM_FIDS);
+	u8 bridge_fid[RTL8365MB_MAX_NUM_BRIDGES + 1];
+	struct rtl8365mb_svlan svlan[RTL8365MB_SVLAN_MC_CONF_SIZE];
+	u16 svlan_uplink;
+	struct mutex meter_lock;
+	struct rtl8365mb_meter meters[RTL8365MB_NUM_METERS];
+	struct mutex acl_lock;
+	struct list_head flower_rules;
+	struct rtl8365mb_acl_rule *acl_rules[RTL8365MB_NUM_ACL_RULES];
+	struct mutex acl_counter_lock;
+	struct rtl8365mb_acl_counter acl_counters[RTL8365MB_NUM_LOG_CNT_PAIRS];
+	struct delayed_work acl_stats_work;
+	struct mutex l2_lock;
+	DECLARE_HASHTABLE(l2_index, RTL8365MB_L2_INDEX_BITS);
+	DECLARE_HASHTABLE(l2_mc, RTL8365MB_L2_INDEX_BITS);
+	DECLARE_HASHTABLE(l2_learned, RTL8365MB_L2_INDEX_BITS);
+	u32 l2_scan_cursor;
+	unsigned int l2_scan_gen;
+	struct delayed_work l2_scan_work;
+	struct list_head l2_events;
+	u16 host_flood_uc;
+	u16 host_flood_mc;
+	u16 learn_limit;
+	enum rtl8365mb_learn_over_act learn_over_act;
+	u32 isolation[RTL8365MB_MAX_NUM_PORTS];
+	u32 isolated;
+	struct rtl8365mb_queue_map queue_maps[RTL8365MB_NUM_QUEUES];
+	struct rtl8365mb_pri_decision pri_decisions[RTL8365MB_NUM_PRI_DECISIONS];
+	u8 dscp_prio[RTL8365MB_NUM_DSCP];
+	u32 dscp_ports[RTL8365MB_NUM_DSCP];
+	u32 storm_kbps[RTL8365MB_STORM_END];
+	struct delayed_work storm_work;
+	bool storm_stopped;
+	u32 copp_kbps[RTL8365MB_COPP_END];
 	struct rtl8365mb_port ports[RTL8365MB_MAX_NUM_PORTS];
 };
 
@@ -945,89 +1805,33 @@ static int rtl8365mb_table_access(struct realtek_priv *priv,
 				  enum rtl8365mb_table_op op,
 				  u16 index, u16 *val)
 {
-	struct rtl8365mb *mb = priv->chip_data;
-	size_t val_size;
-	u32 lut;
-	int ret;
-
 	if (table >= RTL8365MB_NUM_TABLES)
 		return -EINVAL;
 
-	if (!FIELD_FIT(RTL8365MB_TABLE_ACCESS_ADDR_REG_MASK, index))
-		return -EINVAL;
-
-	val_size = rtl8365mb_table_entry_size[table];
-
-	mutex_lock(&mb->table_lock);
-	if (op == RTL8365MB_TABLE_WRITE) {
-		ret = regmap_bulk_write(priv->map,
-					RTL8365MB_TABLE_WRITE_DATA_REG_BASE,
-					val, val_size == 10 ? 9 : val_size);
-
-		if (ret)
-			goto out;
-
-		/* 10th register uses only 4 less significant bits (TODO: not tested) */
-		if (val_size == 10)
-			ret = regmap_update_bits(priv->map,
-					RTL8365MB_TABLE_WRITE_DATA_REG_BASE + 9,
-					RTL8365MB_TABLE_10TH_DATA_REG_MASK,
-					FIELD_PREP(RTL8365MB_TABLE_10TH_DATA_REG_MASK, val[9]));
-		if (ret)
-			goto out;
-
-	} else {
-		/* vendor driver checks busy flag only on read */
-		ret = regmap_read_poll_timeout(priv->map,
-				RTL8365MB_TABLE_LUT_REG, lut,
-				!FIELD_GET(RTL8365MB_TABLE_LUT_BUSY_FLAG_MASK, lut),
-				10, 100);
-		if (ret)
-			goto out;
-	}
-
-	ret = regmap_write(priv->map,
-			   RTL8365MB_TABLE_ACCESS_ADDR_REG,
-			   FIELD_PREP(RTL8365MB_TABLE_ACCESS_ADDR_REG_MASK, index));
-	if (ret)
-		goto out;
+	if (op == RTL8365MB_TABLE_WRITE)
+		return rtl83xx_table_write(priv, &rtl8365mb_tables[table],
+					   index, val, 1);
 
-	ret = regmap_update_bits(priv->map,
-			RTL8365MB_TABLE_CONTROL_REG,
-			RTL8365MB_TABLE_CONTROL_COMMAND_MASK |
-			RTL8365MB_TABLE_CONTROL_TABLE_MASK,
-			FIELD_PREP(RTL8365MB_TABLE_CONTROL_COMMAND_MASK, op) |
-			FIELD_PREP(RTL8365MB_TABLE_CONTROL_TABLE_MASK, table));
-	if (ret)
-		goto out;
+	return rtl83xx_table_read(priv, &rtl8365mb_tables[table], index, val,
+				  1);
+}
 
-	if (op == RTL8365MB_TABLE_READ) {
-		ret = regmap_read(priv->map,
-				  RTL8365MB_TABLE_LUT_REG,
-				  &lut);
-
-		ret = regmap_read_poll_timeout(priv->map,
-				RTL8365MB_TABLE_LUT_REG, lut,
-				!FIELD_GET(RTL8365MB_TABLE_LUT_BUSY_FLAG_MASK,
-					    lut),
-				10, 100);
-		if (ret)
-			goto out;
+/* The VLAN protocol of a bridge is not offloaded by DSA, so it is sampled
+ * whenever VLANs or VLAN filtering are configured. @br is the device the
+ * request originates from, the bridge of @port is used if it is not a bridge.
+ */
+static bool rtl8365mb_port_is_8021ad(struct dsa_switch *ds, int port,
+				     const struct net_device *br)
+{
+	u16 proto;
 
-		ret = regmap_bulk_read(priv->map,
-				       RTL8365MB_TABLE_READ_DATA_REG_BASE,
-				       val, val_size);
-		if (ret)
-			goto out;
+	if (!br || !netif_is_bridge_master(br))
+		br = dsa_port_bridge_dev_get(dsa_to_port(ds, port));
 
-		/* 10th register uses only 4 less significant bits (TODO: not tested) */
-		if (val_size == 10)
-			val[9] &= RTL8365MB_TABLE_10TH_DATA_REG_MASK;
-	}
+	if (!br || br_vlan_get_proto(br, &proto))
+		return false;
 
-out:
-	mutex_unlock(&mb->table_lock);
-	return ret;
+	return proto == ETH_P_8021AD;
 }
 
 static int rtl8365mb_vlan_filtering(struct dsa_switch *ds, int port,
@@ -1039,6 +1843,16 @@ static int rtl8365mb_vlan_filtering(struct dsa_switch *ds, int port,
 	dev_dbg(priv->dev, "port %d: %s VLAN filtering\n", port,
 		vlan_filtering ? "enable" : "disable");
 
+	/* In an 802.1ad bridge the C-tag belongs to the customer and S-VLAN
+	 * membership is enforced by the SVLAN table, so keep the C-VLAN
+	 * ingress filter out of the way.
+	 */
+	if (vlan_filtering && rtl8365mb_port_is_8021ad(ds, port, NULL)) {
+		dev_dbg(priv->dev, "port %d: 802.1ad bridge, S-VLAN filtering\n",
+			port);
+		vlan_filtering = false;
+	}
+
 	/* If the port is not in the member set, the frame will be dropped */
 	return regmap_update_bits(priv->map, RTL8365MB_VLAN_INGRESS_REG,
 				 BIT(port), vlan_filtering ? BIT(port) : 0);
@@ -1057,11 +1871,9 @@ static void rtl8365mb_buf_vlan4k(u16 *buf, struct rtl8366_vlan_4k *vlan4k)
 	vlan4k->fid = FIELD_GET(RTL8365MB_VLAN_4K_CONF1_FID_MSI_MASK, buf[1]);
 	/* vlan4k->vlan_based_pri_enabled = FIELD_GET(RTL8365MB_VLAN_4K_CONF1_VBPEN_MASK, buf[1]); */
 	/* vlan4k->priority = FIELD_GET(RTL8365MB_VLAN_4K_CONF1_VBPRI_MASK, buf[1]); */
-	/* vlan4k->vlan_policy_enabled = FIELD_GET(RTL8365MB_VLAN_4K_CONF1_ENVLANPOL_MASK, buf[1]); */
-	/* vlan4k->meter_idx = FIELD_GET(RTL8365MB_VLAN_4K_CONF1_METER_IDX_LS_MASK, buf[1]) |
-		    (FIELD_GET(RTL8365MB_VLAN_4K_CONF2_METER_IDX_MS_MASK, buf[2]) <<
-		     FIELD_WIDTH(RTL8365MB_VLAN_4K_CONF1_METER_IDX_LS_MASK));
-	*/
+	/* The policing fields are not used by the driver and are left
+	 * untouched by rtl8365mb_vlan4k_buf().
+	 */
 }
 
 static void rtl8365mb_vlan4k_buf(struct rtl8366_vlan_4k *vlan4k, u16 *buf)
@@ -1077,6 +1889,9 @@ static void rtl8365mb_vlan4k_buf(struct rtl8366_vlan_4k *vlan4k, u16 *buf)
 	buf[1] |= FIELD_PREP(RTL8365MB_VLAN_4K_CONF1_FID_MSI_MASK,
 				    vlan4k->fid);
 
+	/* Shared VLAN learning: addresses are looked up by port-based FID */
+	buf[1] &= ~RTL8365MB_VLAN_4K_CONF1_IVL_SVL_MASK;
+
 	/*buf[1] &= ~RTL8365MB_VLAN_4K_CONF1_VBPRI_MASK;
 	buf[1] |= FIELD_PREP(RTL8365MB_VLAN_4K_CONF1_VBPRI_MASK,
 				    vlan4k->priority);*/
@@ -1095,6 +1910,7 @@ static int rtl8365mb_vlan4k_set(struct dsa_switch *ds, int port,
 {
 	u16 vlan_entry[RTL8365MB_VLAN_4K_ENTRY_SIZE] = {0, 0, 0};
 	struct realtek_priv *priv = ds->priv;
+	struct rtl8365mb *mb = priv->chip_data;
 	struct rtl8366_vlan_4k vlan4k = {0};
 	int ret;
 
@@ -1110,6 +1926,7 @@ static int rtl8365mb_vlan4k_set(struct dsa_switch *ds, int port,
 		return -EINVAL;
 	}
 
+	mutex_lock(&mb->table_lock);
 	ret = rtl8365mb_table_access(priv, RTL8365MB_TABLE_CVLAN,
 				     RTL8365MB_TABLE_READ, vlan->vid,
 				     vlan_entry);
@@ -1117,7 +1934,7 @@ static int rtl8365mb_vlan4k_set(struct dsa_switch *ds, int port,
 		if (extack)
 			NL_SET_ERR_MSG_MOD(extack, \
 					   "Failed to read VLAN 4k table");
-		return ret;
+		goto out;
 	}
 
 	/* vlan4k.vid = vlan->vid; */
@@ -1140,6 +1957,9 @@ static int rtl8365mb_vlan4k_set(struct dsa_switch *ds, int port,
 				     RTL8365MB_TABLE_WRITE, vlan->vid,
 				     vlan_entry);
 
+out:
+	mutex_unlock(&mb->table_lock);
+
 	return ret;
 }
 
@@ -1387,99 +2207,3708 @@ static int rtl8365mb_vlanmc_set(struct dsa_switch *ds, int port,
 	return ret;
 }
 
-static int rtl8365mb_vlan_add(struct dsa_switch *ds, int port,
-			      const struct switchdev_obj_port_vlan *vlan,
-			      struct netlink_ext_ack *extack)
+static int rtl8365mb_svlan_write(struct realtek_priv *priv, int idx)
 {
-	bool untagged = !!(vlan->flags & BRIDGE_VLAN_INFO_UNTAGGED);
-	bool pvid = !!(vlan->flags & BRIDGE_VLAN_INFO_PVID);
-	struct realtek_priv *priv = ds->priv;
+	struct rtl8365mb *mb = priv->chip_data;
+	const struct rtl8365mb_svlan *sv = &mb->svlan[idx];
+	u16 data[3];
 	int ret;
 
-	dev_dbg(priv->dev, "add VLAN %d on port %d, %s, %s\n",
-		vlan->vid, port, untagged ? "untagged" : "tagged",
-		pvid ? "PVID" : "no PVID");
+	data[0] = FIELD_PREP(RTL8365MB_SVLAN_MC_CONF0_MEMBERS_LS_MASK,
+			     sv->member & FIELD_MAX(RTL8365MB_SVLAN_MC_CONF0_MEMBERS_LS_MASK)) |
+		  FIELD_PREP(RTL8365MB_SVLAN_MC_CONF0_UNTAG_LS_MASK,
+			     sv->untag & FIELD_MAX(RTL8365MB_SVLAN_MC_CONF0_UNTAG_LS_MASK));
+	/* No forced FID: learning follows the port-based FID */
+	data[1] = 0;
+	data[2] = FIELD_PREP(RTL8365MB_SVLAN_MC_CONF2_SVID_MASK, sv->svid);
 
-	/* Vlan mc knowns nothing about untagged but it is required for pvid */
-	ret = rtl8365mb_vlanmc_set(ds, port, vlan, extack, 1);
+	ret = regmap_bulk_write(priv->map, RTL8365MB_SVLAN_MC_CONF_REG(idx),
+				data, ARRAY_SIZE(data));
 	if (ret)
 		return ret;
 
-	/* vlan4k knowns nothing about PVID */
-	ret = rtl8365mb_vlan4k_set(ds, port, vlan, extack, 1);
-	if (ret) {
-		rtl8365mb_vlanmc_set(ds, port, vlan, extack, 0);
+	return regmap_write(priv->map, RTL8365MB_SVLAN_MC_CONF_EXT_REG(idx),
+		FIELD_PREP(RTL8365MB_SVLAN_MC_EXT_MEMBERS_MS_MASK,
+			   sv->member >> FIELD_WIDTH(RTL8365MB_SVLAN_MC_CONF0_MEMBERS_LS_MASK)) |
+		FIELD_PREP(RTL8365MB_SVLAN_MC_EXT_UNTAG_MS_MASK,
+			   sv->untag >> FIELD_WIDTH(RTL8365MB_SVLAN_MC_CONF0_UNTAG_LS_MASK)));
+}
+
+/* Uplink ports send S-tagged frames and classify received frames by their
+ * S-tag. Other ports strip the S-tag on egress and assign their port-based
+ * S-VLAN on ingress. This is a per-port setting, so a port is an uplink when
+ * it is a tagged member of any S-VLAN.
+ */
+static int rtl8365mb_svlan_sync_uplink(struct realtek_priv *priv)
+{
+	struct rtl8365mb *mb = priv->chip_data;
+	u16 uplink = 0;
+	int ret;
+	int i;
+
+	for (i = 1; i < RTL8365MB_SVLAN_MC_CONF_SIZE; i++)
+		uplink |= mb->svlan[i].member & ~mb->svlan[i].untag;
+
+	if (uplink == mb->svlan_uplink)
+		return 0;
+
+	ret = regmap_write(priv->map, RTL8365MB_SVLAN_UPLINK_PORTMASK_REG,
+			   FIELD_PREP(RTL8365MB_SVLAN_UPLINK_PORTMASK_MASK,
+				      uplink));
+	if (ret)
 		return ret;
-	}
 
-	/* TODO: fid? */
-	//ret_t rtl8367c_getAsicPortBasedFid(rtk_uint32 port, rtk_uint32* pFid)
+	mb->svlan_uplink = uplink;
 
 	return 0;
 }
 
-static int rtl8365mb_vlan_del(struct dsa_switch *ds, int port,
-			      const struct switchdev_obj_port_vlan *vlan)
+static int rtl8365mb_port_set_svidx(struct realtek_priv *priv, int port,
+				    int idx)
 {
-	struct realtek_priv *priv = ds->priv;
-	int ret, ret2;
+	struct rtl8365mb *mb = priv->chip_data;
+	int ret;
 
-	dev_dbg(priv->dev, "del VLAN %d on port %d\n", vlan->vid, port);
+	if (mb->ports[port].svidx == idx)
+		return 0;
 
-	ret = rtl8365mb_vlan4k_set(ds, port, vlan, NULL, 0);
-	/* clean vlan mc if present */
-	ret2 = rtl8365mb_vlanmc_set(ds, port, vlan, NULL, 0);
+	ret = regmap_update_bits(priv->map,
+			RTL8365MB_SVLAN_PORTBASED_SVIDX_REG(port),
+			RTL8365MB_SVLAN_PORTBASED_SVIDX_MASK(port),
+			idx << RTL8365MB_SVLAN_PORTBASED_SVIDX_OFFSET(port));
+	if (ret)
+		return ret;
 
-	return ret || ret2;
+	mb->ports[port].svidx = idx;
+
+	return 0;
 }
 
-static const struct rtl8365mb_extint *
-rtl8365mb_get_port_extint(struct realtek_priv *priv, int port)
+static int rtl8365mb_svlan_add(struct dsa_switch *ds, int port,
+			       const struct switchdev_obj_port_vlan *vlan,
+			       struct netlink_ext_ack *extack)
 {
+	bool untagged = !!(vlan->flags & BRIDGE_VLAN_INFO_UNTAGGED);
+	struct realtek_priv *priv = ds->priv;
 	struct rtl8365mb *mb = priv->chip_data;
+	struct rtl8365mb_svlan *sv, old;
+	int free_idx = 0;
+	int idx = 0;
+	int ret;
 	int i;
 
-	for (i = 0; i < RTL8365MB_MAX_NUM_EXTINTS; i++) {
-		const struct rtl8365mb_extint *extint =
-			&mb->chip_info->extints[i];
+	if (!vlan->vid || vlan->vid > RTL8365MB_MAX_4K_VID) {
+		NL_SET_ERR_MSG_FMT_MOD(extack,
+				       "S-VLAN ID must be between 1 and %d",
+				       RTL8365MB_MAX_4K_VID);
+		return -EINVAL;
+	}
 
-		if (!extint->supported_interfaces)
+	mutex_lock(&mb->table_lock);
+
+	/* Entry 0 is reserved for ports without a port-based S-VLAN */
+	for (i = 1; i < RTL8365MB_SVLAN_MC_CONF_SIZE; i++) {
+		sv = &mb->svlan[i];
+
+		if (sv->svid == vlan->vid) {
+			idx = i;
+			continue;
+		}
+
+		if (!sv->svid) {
+			if (!free_idx)
+				free_idx = i;
 			continue;
+		}
 
-		if (extint->port == port)
-			return extint;
+		if ((sv->member & BIT(port)) &&
+		    !!(sv->untag & BIT(port)) != untagged) {
+			NL_SET_ERR_MSG_MOD(extack,
+					   "Port cannot mix S-tagged and untagged S-VLANs");
+			ret = -EOPNOTSUPP;
+			goto out;
+		}
 	}
 
-	return NULL;
-}
+	if (!idx) {
+		if (!free_idx) {
+			NL_SET_ERR_MSG_FMT_MOD(extack,
+					       "All SVLAN entries (%d) are in use",
+					       RTL8365MB_SVLAN_MC_CONF_SIZE - 1);
+			ret = -ENOSPC;
+			goto out;
+		}
 
-static enum dsa_tag_protocol
-rtl8365mb_get_tag_protocol(struct dsa_switch *ds, int port,
-			   enum dsa_tag_protocol mp)
-{
-	struct realtek_priv *priv = ds->priv;
-	struct rtl8365mb_cpu *cpu;
-	struct rtl8365mb *mb;
+		idx = free_idx;
+	}
 
-	mb = priv->chip_data;
-	cpu = &mb->cpu;
+	sv = &mb->svlan[idx];
+	old = *sv;
 
-	if (cpu->position == RTL8365MB_CPU_POS_BEFORE_CRC)
-		return DSA_TAG_PROTO_RTL8_4T;
+	sv->svid = vlan->vid;
+	sv->member |= BIT(port);
+	if (untagged)
+		sv->untag |= BIT(port);
+	else
+		sv->untag &= ~BIT(port);
 
-	return DSA_TAG_PROTO_RTL8_4;
-}
+	ret = rtl8365mb_svlan_write(priv, idx);
+	if (ret) {
+		NL_SET_ERR_MSG_MOD(extack, "Failed to write SVLAN entry");
+		*sv = old;
+		goto out;
+	}
 
-static int rtl8365mb_ext_config_rgmii(struct realtek_priv *priv, int port,
-				      phy_interface_t interface)
-{
-	const struct rtl8365mb_extint *extint =
-		rtl8365mb_get_port_extint(priv, port);
-	struct dsa_switch *ds = &priv->ds;
-	struct device_node *dn;
-	struct dsa_port *dp;
-	int tx_delay = 0;
-	int rx_delay = 0;
+	ret = rtl8365mb_svlan_sync_uplink(priv);
+	if (ret) {
+		NL_SET_ERR_MSG_MOD(extack, "Failed to set SVLAN uplink ports");
+		goto err_restore;
+	}
+
+	if (vlan->flags & BRIDGE_VLAN_INFO_PVID) {
+		ret = rtl8365mb_port_set_svidx(priv, port, idx);
+		if (ret) {
+			NL_SET_ERR_MSG_MOD(extack, "Failed to set port S-VLAN");
+			goto err_restore;
+		}
+	}
+
+	dev_dbg(priv->dev, "S-VLAN %d at index %d: members 0x%03x untag 0x%03x\n",
+		sv->svid, idx, sv->member, sv->untag);
+
+	mutex_unlock(&mb->table_lock);
+
+	return 0;
+
+err_restore:
+	*sv = old;
+	rtl8365mb_svlan_write(priv, idx);
+	rtl8365mb_svlan_sync_uplink(priv);
+out:
+	mutex_unlock(&mb->table_lock);
+
+	return ret;
+}
+
+/* Return -ENOENT if @port is not a member of the S-VLAN */
+static int rtl8365mb_svlan_del(struct dsa_switch *ds, int port,
+			       const struct switchdev_obj_port_vlan *vlan)
+{
+	struct realtek_priv *priv = ds->priv;
+	struct rtl8365mb *mb = priv->chip_data;
+	struct rtl8365mb_svlan *sv;
+	int ret = 0;
+	int idx;
+
+	mutex_lock(&mb->table_lock);
+
+	for (idx = 1; idx < RTL8365MB_SVLAN_MC_CONF_SIZE; idx++)
+		if (mb->svlan[idx].svid == vlan->vid)
+			break;
+
+	if (idx == RTL8365MB_SVLAN_MC_CONF_SIZE ||
+	    !(mb->svlan[idx].member & BIT(port))) {
+		ret = -ENOENT;
+		goto out;
+	}
+
+	sv = &mb->svlan[idx];
+	sv->member &= ~BIT(port);
+	sv->untag &= ~BIT(port);
+
+	/* DSA does not remove the CPU port, free the entry without users */
+	if (!(sv->member & ~dsa_cpu_ports(ds)))
+		memset(sv, 0, sizeof(*sv));
+
+	ret = rtl8365mb_svlan_write(priv, idx);
+	if (ret)
+		goto out;
+
+	ret = rtl8365mb_svlan_sync_uplink(priv);
+	if (ret)
+		goto out;
+
+	if (mb->ports[port].svidx == idx)
+		ret = rtl8365mb_port_set_svidx(priv, port, 0);
+
+out:
+	mutex_unlock(&mb->table_lock);
+
+	return ret;
+}
+
+static int rtl8365mb_vlan_add(struct dsa_switch *ds, int port,
+			      const struct switchdev_obj_port_vlan *vlan,
+			      struct netlink_ext_ack *extack)
+{
+	bool untagged = !!(vlan->flags & BRIDGE_VLAN_INFO_UNTAGGED);
+	bool pvid = !!(vlan->flags & BRIDGE_VLAN_INFO_PVID);
+	struct realtek_priv *priv = ds->priv;
+	int ret;
+
+	dev_dbg(priv->dev, "add VLAN %d on port %d, %s, %s\n",
+		vlan->vid, port, untagged ? "untagged" : "tagged",
+		pvid ? "PVID" : "no PVID");
+
+	if (rtl8365mb_port_is_8021ad(ds, port, vlan->obj.orig_dev))
+		return rtl8365mb_svlan_add(ds, port, vlan, extack);
+
+	/* Vlan mc knowns nothing about untagged but it is required for pvid */
+	ret = rtl8365mb_vlanmc_set(ds, port, vlan, extack, 1);
+	if (ret)
+		return ret;
+
+	/* vlan4k knowns nothing about PVID */
+	ret = rtl8365mb_vlan4k_set(ds, port, vlan, extack, 1);
+	if (ret) {
+		rtl8365mb_vlanmc_set(ds, port, vlan, extack, 0);
+		return ret;
+	}
+
+	/* The FID of the VLAN entry is left at zero: the port-based FID takes
+	 * precedence for address lookup, so here it only selects MSTI 0, which
+	 * holds the port STP states.
+	 */
+
+	return 0;
+}
+
+static int rtl8365mb_vlan_del(struct dsa_switch *ds, int port,
+			      const struct switchdev_obj_port_vlan *vlan)
+{
+	struct realtek_priv *priv = ds->priv;
+	int ret, ret2;
+
+	dev_dbg(priv->dev, "del VLAN %d on port %d\n", vlan->vid, port);
+
+	/* The bridge VLAN protocol may have changed since the VLAN was added,
+	 * so remove it from the table holding it rather than the one matching
+	 * the current protocol. The SVLAN image records which ports are
+	 * S-VLAN members.
+	 */
+	ret = rtl8365mb_svlan_del(ds, port, vlan);
+	if (ret != -ENOENT)
+		return ret;
+
+	ret = rtl8365mb_vlan4k_set(ds, port, vlan, NULL, 0);
+	/* clean vlan mc if present */
+	ret2 = rtl8365mb_vlanmc_set(ds, port, vlan, NULL, 0);
+
+	return ret || ret2;
+}
+
+static int rtl8365mb_meter_config(struct realtek_priv *priv, int meter,
+				  u64 rate, u32 burst)
+{
+	u32 units = DIV_ROUND_UP_ULL(rate, RTL8365MB_METER_RATE_UNIT_BPS);
+	u16 val[2];
+	int ret;
+
+	val[0] = FIELD_PREP(RTL8365MB_METER_RATE_CTRL0_MASK, units & 0xFFFF);
+	val[1] = FIELD_PREP(RTL8365MB_METER_RATE_CTRL1_MASK, units >> 16);
+	ret = regmap_bulk_write(priv->map, RTL8365MB_METER_RATE_REG(meter), val,
+				ARRAY_SIZE(val));
+	if (ret)
+		return ret;
+
+	ret = regmap_write(priv->map, RTL8365MB_METER_BUCKET_SIZE_REG(meter),
+			   FIELD_PREP(RTL8365MB_METER_BUCKET_SIZE_MASK, burst));
+	if (ret)
+		return ret;
+
+	/* tc expresses rates in layer 2 bytes, so leave the interframe gap
+	 * and preamble out of the token accounting
+	 */
+	return regmap_update_bits(priv->map, RTL8365MB_METER_IFG_REG(meter),
+				  RTL8365MB_METER_IFG_MASK(meter), 0);
+}
+
+/**
+ * rtl8365mb_meter_get() - allocate and program a shared meter
+ * @priv: realtek_priv pointer
+ * @rate: rate in bytes per second
+ * @burst: bucket size in bytes
+ * @extack: netlink extended ack for error reporting
+ *
+ * Meters are a global resource shared by every policing feature of the
+ * switch. Each user gets a meter of its own, since sharing one between
+ * unrelated users would make them police their aggregate traffic.
+ *
+ * Return: meter index, or a negative error code.
+ */
+static int rtl8365mb_meter_get(struct realtek_priv *priv, u64 rate, u32 burst,
+			       struct netlink_ext_ack *extack)
+{
+	struct rtl8365mb *mb = priv->chip_data;
+	u64 units = DIV_ROUND_UP_ULL(rate, RTL8365MB_METER_RATE_UNIT_BPS);
+	int meter;
+	int ret;
+
+	if (!units || units > RTL8365MB_METER_RATE_MAX) {
+		NL_SET_ERR_MSG_FMT_MOD(extack,
+				       "Rate must be between 8 Kbps and %lu Kbps",
+				       RTL8365MB_METER_RATE_MAX * 8);
+		return -ERANGE;
+	}
+
+	if (burst > FIELD_MAX(RTL8365MB_METER_BUCKET_SIZE_MASK)) {
+		NL_SET_ERR_MSG_FMT_MOD(extack,
+				       "Burst must not exceed %lu bytes",
+				       FIELD_MAX(RTL8365MB_METER_BUCKET_SIZE_MASK));
+		return -ERANGE;
+	}
+
+	mutex_lock(&mb->meter_lock);
+
+	for (meter = 0; meter < RTL8365MB_NUM_METERS; meter++)
+		if (!mb->meters[meter].refcount)
+			break;
+
+	if (meter == RTL8365MB_NUM_METERS) {
+		NL_SET_ERR_MSG_MOD(extack, "No free meter available");
+		ret = -ENOSPC;
+		goto out;
+	}
+
+	ret = rtl8365mb_meter_config(priv, meter, rate, burst);
+	if (ret) {
+		NL_SET_ERR_MSG_MOD(extack, "Failed to program meter");
+		goto out;
+	}
+
+	mb->meters[meter].refcount = 1;
+	mb->meters[meter].rate = rate;
+	mb->meters[meter].burst = burst;
+	ret = meter;
+
+out:
+	mutex_unlock(&mb->meter_lock);
+
+	return ret;
+}
+
+static void rtl8365mb_meter_put(struct realtek_priv *priv, int meter)
+{
+	struct rtl8365mb *mb = priv->chip_data;
+
+	mutex_lock(&mb->meter_lock);
+	if (!WARN_ON(!mb->meters[meter].refcount))
+		mb->meters[meter].refcount--;
+	mutex_unlock(&mb->meter_lock);
+}
+
+static void rtl8365mb_meter_hold(struct realtek_priv *priv, int meter)
+{
+	struct rtl8365mb *mb = priv->chip_data;
+
+	mutex_lock(&mb->meter_lock);
+	mb->meters[meter].refcount++;
+	mutex_unlock(&mb->meter_lock);
+}
+
+/* Bucket size of a meter configured by the driver itself: 10 ms worth of
+ * traffic, and at least one full frame
+ */
+static u32 rtl8365mb_meter_burst(u64 rate)
+{
+	return clamp_t(u64, div_u64(rate, 100),
+		       VLAN_ETH_FRAME_LEN + ETH_FCS_LEN,
+		       FIELD_MAX(RTL8365MB_METER_BUCKET_SIZE_MASK));
+}
+
+static int rtl8365mb_port_set_ingress_rate(struct realtek_priv *priv,
+					   int port, u32 units)
+{
+	u16 val[2];
+	int ret;
+
+	val[0] = FIELD_PREP(RTL8365MB_PORT_INGRESSBW_RATE_CTRL0_MASK,
+			    units & 0xFFFF);
+	val[1] = FIELD_PREP(RTL8365MB_PORT_INGRESSBW_RATE_CTRL1_MASK,
+			    units >> 16);
+	ret = regmap_bulk_write(priv->map,
+				RTL8365MB_PORT_INGRESSBW_RATE_REG(port), val,
+				ARRAY_SIZE(val));
+	if (ret)
+		return ret;
+
+	/* tc expresses rates in layer 2 bytes and polices by dropping, so
+	 * leave the interframe gap and preamble out and send no pause frames
+	 */
+	return regmap_update_bits(priv->map, RTL8365MB_PORT_MISC_CFG_REG(port),
+				  RTL8365MB_PORT_MISC_CFG_INGRESSBW_IFG_MASK |
+				  RTL8365MB_PORT_MISC_CFG_INGRESSBW_FC_MASK,
+				  0);
+}
+
+static int rtl8365mb_port_policer_add(struct dsa_switch *ds, int port,
+				      struct dsa_mall_policer_tc_entry *policer)
+{
+	u64 units = DIV_ROUND_UP_ULL(policer->rate_bytes_per_sec,
+				     RTL8365MB_METER_RATE_UNIT_BPS);
+
+	/* The bucket size of the ingress bandwidth control is fixed. Rates
+	 * beyond the largest one are above the port speed and need no limit.
+	 */
+	units = clamp_t(u64, units, 1, RTL8365MB_PORT_INGRESSBW_RATE_MAX);
+
+	return rtl8365mb_port_set_ingress_rate(ds->priv, port, units);
+}
+
+static void rtl8365mb_port_policer_del(struct dsa_switch *ds, int port)
+{
+	struct realtek_priv *priv = ds->priv;
+	int ret;
+
+	ret = rtl8365mb_port_set_ingress_rate(priv, port,
+					      RTL8365MB_PORT_INGRESSBW_RATE_MAX);
+	if (ret)
+		dev_err(priv->dev, "failed to remove policer on port %d: %d\n",
+			port, ret);
+}
+
+static int rtl8365mb_port_set_egress_rate(struct realtek_priv *priv,
+					  int port, u32 units)
+{
+	u16 val[2];
+
+	val[0] = FIELD_PREP(RTL8365MB_PORT_EGRESSBW_RATE_CTRL0_MASK,
+			    units & 0xFFFF);
+	val[1] = FIELD_PREP(RTL8365MB_PORT_EGRESSBW_RATE_CTRL1_MASK,
+			    units >> 16);
+
+	return regmap_bulk_write(priv->map,
+				 RTL8365MB_PORT_EGRESSBW_RATE_REG(port), val,
+				 ARRAY_SIZE(val));
+}
+
+static int rtl8365mb_port_setup_tbf(struct dsa_switch *ds, int port,
+				    struct tc_tbf_qopt_offload *qopt)
+{
+	u64 units;
+
+	/* Only the port as a whole can be shaped */
+	if (qopt->parent != TC_H_ROOT)
+		return -EOPNOTSUPP;
+
+	switch (qopt->command) {
+	case TC_TBF_REPLACE:
+		/* The bucket size of the egress bandwidth control is fixed.
+		 * Rates beyond the largest one are above the port speed.
+		 */
+		units = DIV_ROUND_UP_ULL(qopt->replace_params.rate.rate_bytes_ps,
+					 RTL8365MB_METER_RATE_UNIT_BPS);
+		units = clamp_t(u64, units, 1,
+				RTL8365MB_PORT_EGRESSBW_RATE_MAX);
+		break;
+	case TC_TBF_DESTROY:
+		units = RTL8365MB_PORT_EGRESSBW_RATE_MAX;
+		break;
+	default:
+		return -EOPNOTSUPP;
+	}
+
+	return rtl8365mb_port_set_egress_rate(ds->priv, port, units);
+}
+
+static int rtl8365mb_port_set_num_queues(struct realtek_priv *priv, int port,
+					 unsigned int num_queues)
+{
+	return regmap_update_bits(priv->map,
+				  RTL8365MB_QOS_PORT_QUEUE_NUM_REG(port),
+				  RTL8365MB_QOS_PORT_QUEUE_NUM_MASK(port),
+				  (num_queues - 1) <<
+				  RTL8365MB_QOS_PORT_QUEUE_NUM_OFFSET(port));
+}
+
+static int rtl8365mb_queue_map_write(struct realtek_priv *priv,
+				     unsigned int num_queues, const u8 *qid)
+{
+	int ret;
+	int pri;
+
+	for (pri = 0; pri < RTL8365MB_NUM_PRIORITIES; pri++) {
+		ret = regmap_update_bits(priv->map,
+					 RTL8365MB_QOS_PRI_TO_QID_REG(num_queues, pri),
+					 RTL8365MB_QOS_PRI_TO_QID_MASK(pri),
+					 qid[pri] << RTL8365MB_QOS_PRI_TO_QID_OFFSET(pri));
+		if (ret)
+			return ret;
+	}
+
+	return 0;
+}
+
+static int rtl8365mb_queue_set_sched(struct realtek_priv *priv, int port,
+				     int queue, unsigned int weight)
+{
+	int ret;
+
+	/* A zero weight makes the queue strict priority */
+	ret = regmap_update_bits(priv->map,
+				 RTL8365MB_SCHEDULE_QUEUE_TYPE_REG(port),
+				 RTL8365MB_SCHEDULE_QUEUE_TYPE_STRICT_MASK(port, queue),
+				 weight ? 0 :
+				 RTL8365MB_SCHEDULE_QUEUE_TYPE_STRICT_MASK(port, queue));
+	if (ret || !weight)
+		return ret;
+
+	weight = min_t(unsigned int, weight,
+		       FIELD_MAX(RTL8365MB_SCHEDULE_WFQ_WEIGHT_MASK));
+
+	return regmap_write(priv->map,
+			    RTL8365MB_SCHEDULE_WFQ_WEIGHT_REG(port, queue),
+			    FIELD_PREP(RTL8365MB_SCHEDULE_WFQ_WEIGHT_MASK,
+				       weight));
+}
+
+static int rtl8365mb_ets_replace(struct realtek_priv *priv, int port,
+				 struct tc_ets_qopt_offload_replace_params *p)
+{
+	struct rtl8365mb *mb = priv->chip_data;
+	struct rtl8365mb_port *mp = &mb->ports[port];
+	unsigned int num_queues = p->bands;
+	struct rtl8365mb_queue_map *map;
+	u8 qid[RTL8365MB_NUM_PRIORITIES];
+	bool owned;
+	int band;
+	int ret;
+	int pri;
+
+	if (num_queues > RTL8365MB_NUM_QUEUES)
+		return -EOPNOTSUPP;
+
+	/* Band 0 is served first, while higher queues take precedence */
+	for (pri = 0; pri < RTL8365MB_NUM_PRIORITIES; pri++)
+		qid[pri] = num_queues - 1 - p->priomap[pri];
+
+	map = &mb->queue_maps[num_queues - 1];
+	owned = mp->num_queues == num_queues;
+
+	if (map->refcount > owned && memcmp(map->qid, qid, sizeof(qid))) {
+		dev_err(priv->dev,
+			"port %d: priority map conflicts with other ports using %u bands\n",
+			port, num_queues);
+		return -EBUSY;
+	}
+
+	if (map->refcount <= owned) {
+		ret = rtl8365mb_queue_map_write(priv, num_queues, qid);
+		if (ret)
+			return ret;
+
+		memcpy(map->qid, qid, sizeof(qid));
+	}
+
+	for (band = 0; band < num_queues; band++) {
+		ret = rtl8365mb_queue_set_sched(priv, port,
+						num_queues - 1 - band,
+						p->quanta[band] ?
+						max(p->weights[band], 1U) : 0);
+		if (ret)
+			return ret;
+	}
+
+	ret = rtl8365mb_port_set_num_queues(priv, port, num_queues);
+	if (ret)
+		return ret;
+
+	if (!owned) {
+		if (mp->num_queues > 1)
+			mb->queue_maps[mp->num_queues - 1].refcount--;
+		map->refcount++;
+		mp->num_queues = num_queues;
+	}
+
+	return 0;
+}
+
+static int rtl8365mb_ets_destroy(struct realtek_priv *priv, int port)
+{
+	struct rtl8365mb *mb = priv->chip_data;
+	struct rtl8365mb_port *mp = &mb->ports[port];
+	int ret;
+
+	ret = rtl8365mb_port_set_num_queues(priv, port, 1);
+	if (ret)
+		return ret;
+
+	if (mp->num_queues > 1)
+		mb->queue_maps[mp->num_queues - 1].refcount--;
+	mp->num_queues = 1;
+
+	return 0;
+}
+
+static int rtl8365mb_port_setup_ets(struct dsa_switch *ds, int port,
+				    struct tc_ets_qopt_offload *qopt)
+{
+	/* Only the port as a whole has queues */
+	if (qopt->parent != TC_H_ROOT)
+		return -EOPNOTSUPP;
+
+	switch (qopt->command) {
+	case TC_ETS_REPLACE:
+		return rtl8365mb_ets_replace(ds->priv, port,
+					     &qopt->replace_params);
+	case TC_ETS_DESTROY:
+		return rtl8365mb_ets_destroy(ds->priv, port);
+	default:
+		return -EOPNOTSUPP;
+	}
+}
+
+static int rtl8365mb_port_setup_tc(struct dsa_switch *ds, int port,
+				   enum tc_setup_type type, void *type_data)
+{
+	switch (type) {
+	case TC_SETUP_QDISC_TBF:
+		return rtl8365mb_port_setup_tbf(ds, port, type_data);
+	case TC_SETUP_QDISC_ETS:
+		return rtl8365mb_port_setup_ets(ds, port, type_data);
+	default:
+		return -EOPNOTSUPP;
+	}
+}
+
+static int rtl8365mb_port_get_default_prio(struct dsa_switch *ds, int port)
+{
+	struct realtek_priv *priv = ds->priv;
+	u32 val;
+	int ret;
+
+	ret = regmap_read(priv->map, RTL8365MB_QOS_PORT_PRI_REG(port), &val);
+	if (ret)
+		return ret;
+
+	return (val & RTL8365MB_QOS_PORT_PRI_MASK(port)) >>
+	       RTL8365MB_QOS_PORT_PRI_OFFSET(port);
+}
+
+static int rtl8365mb_port_set_default_prio(struct dsa_switch *ds, int port,
+					   u8 prio)
+{
+	struct realtek_priv *priv = ds->priv;
+
+	return regmap_update_bits(priv->map, RTL8365MB_QOS_PORT_PRI_REG(port),
+				  RTL8365MB_QOS_PORT_PRI_MASK(port),
+				  prio << RTL8365MB_QOS_PORT_PRI_OFFSET(port));
+}
+
+static int rtl8365mb_dscp_set_prio(struct realtek_priv *priv, u8 dscp,
+				   u8 prio)
+{
+	struct rtl8365mb *mb = priv->chip_data;
+	int ret;
+
+	ret = regmap_update_bits(priv->map, RTL8365MB_QOS_DSCP_PRI_REG(dscp),
+				 RTL8365MB_QOS_DSCP_PRI_MASK(dscp),
+				 prio << RTL8365MB_QOS_DSCP_PRI_OFFSET(dscp));
+	if (ret)
+		return ret;
+
+	mb->dscp_prio[dscp] = prio;
+
+	return 0;
+}
+
+static int rtl8365mb_port_get_dscp_prio(struct dsa_switch *ds, int port,
+					u8 dscp)
+{
+	struct realtek_priv *priv = ds->priv;
+	struct rtl8365mb *mb = priv->chip_data;
+
+	if (!(mb->dscp_ports[dscp] & BIT(port)))
+		return -EOPNOTSUPP;
+
+	return mb->dscp_prio[dscp];
+}
+
+/* The DSCP mapping is global, so ports may only map a DSCP the same way */
+static int rtl8365mb_port_add_dscp_prio(struct dsa_switch *ds, int port,
+					u8 dscp, u8 prio)
+{
+	struct realtek_priv *priv = ds->priv;
+	struct rtl8365mb *mb = priv->chip_data;
+	int ret;
+
+	if (mb->dscp_ports[dscp] & ~BIT(port) && mb->dscp_prio[dscp] != prio) {
+		dev_err(priv->dev,
+			"port %d: DSCP %u is mapped to priority %u by other ports\n",
+			port, dscp, mb->dscp_prio[dscp]);
+		return -EBUSY;
+	}
+
+	ret = rtl8365mb_dscp_set_prio(priv, dscp, prio);
+	if (ret)
+		return ret;
+
+	mb->dscp_ports[dscp] |= BIT(port);
+
+	return 0;
+}
+
+static int rtl8365mb_port_del_dscp_prio(struct dsa_switch *ds, int port,
+					u8 dscp, u8 prio)
+{
+	struct realtek_priv *priv = ds->priv;
+	struct rtl8365mb *mb = priv->chip_data;
+
+	if (!(mb->dscp_ports[dscp] & BIT(port)) || mb->dscp_prio[dscp] != prio)
+		return 0;
+
+	mb->dscp_ports[dscp] &= ~BIT(port);
+	if (mb->dscp_ports[dscp])
+		return 0;
+
+	return rtl8365mb_dscp_set_prio(priv, dscp, 0);
+}
+
+/* ACL priority actions win over everything, followed by the trusted
+ * selectors in order of precedence. All other sources rank below the
+ * port-based priority and are never used.
+ */
+static int rtl8365mb_pri_decision_write(struct realtek_priv *priv, int t,
+					const u8 *sel, int nsel)
+{
+	u8 weight[RTL8365MB_PRI_SRC_END];
+	u8 w = RTL8365MB_PRI_SRC_END - 1;
+	int ret;
+	int src;
+	int i;
+
+	weight[RTL8365MB_PRI_SRC_ACL] = w--;
+
+	for (i = 0; i < nsel; i++) {
+		src = sel[i] == IEEE_8021QAZ_APP_SEL_DSCP ?
+		      RTL8365MB_PRI_SRC_DSCP : RTL8365MB_PRI_SRC_1Q;
+		weight[src] = w--;
+	}
+
+	weight[RTL8365MB_PRI_SRC_PORT] = w--;
+
+	for (src = 0; src < RTL8365MB_PRI_SRC_END; src++) {
+		if (src == RTL8365MB_PRI_SRC_ACL || src == RTL8365MB_PRI_SRC_PORT)
+			continue;
+
+		for (i = 0; i < nsel; i++)
+			if ((src == RTL8365MB_PRI_SRC_DSCP &&
+			     sel[i] == IEEE_8021QAZ_APP_SEL_DSCP) ||
+			    (src == RTL8365MB_PRI_SRC_1Q &&
+			     sel[i] == DCB_APP_SEL_PCP))
+				break;
+
+		if (i == nsel)
+			weight[src] = w--;
+	}
+
+	for (src = 0; src < RTL8365MB_PRI_SRC_END; src++) {
+		ret = regmap_update_bits(priv->map,
+					 RTL8365MB_QOS_PRI_DECISION_REG(t, src),
+					 RTL8365MB_QOS_PRI_DECISION_MASK(src),
+					 weight[src] <<
+					 RTL8365MB_QOS_PRI_DECISION_OFFSET(src));
+		if (ret)
+			return ret;
+	}
+
+	return 0;
+}
+
+static int rtl8365mb_port_get_apptrust(struct dsa_switch *ds, int port,
+				       u8 *sel, int *nsel)
+{
+	struct realtek_priv *priv = ds->priv;
+	struct rtl8365mb *mb = priv->chip_data;
+	struct rtl8365mb_pri_decision *d;
+
+	d = &mb->pri_decisions[mb->ports[port].pri_decision];
+	memcpy(sel, d->sel, d->nsel * sizeof(*sel));
+	*nsel = d->nsel;
+
+	return 0;
+}
+
+/* There are only two decision tables, so at most two trust configurations
+ * can be in use at the same time
+ */
+static int rtl8365mb_port_set_apptrust(struct dsa_switch *ds, int port,
+				       const u8 *sel, int nsel)
+{
+	struct realtek_priv *priv = ds->priv;
+	struct rtl8365mb *mb = priv->chip_data;
+	struct rtl8365mb_port *p = &mb->ports[port];
+	struct rtl8365mb_pri_decision *d;
+	int free = -1;
+	int ret;
+	int t;
+	int i;
+
+	if (nsel > ARRAY_SIZE(d->sel))
+		return -EOPNOTSUPP;
+
+	for (i = 0; i < nsel; i++)
+		if (sel[i] != IEEE_8021QAZ_APP_SEL_DSCP &&
+		    sel[i] != DCB_APP_SEL_PCP)
+			return -EOPNOTSUPP;
+
+	for (t = 0; t < RTL8365MB_NUM_PRI_DECISIONS; t++) {
+		d = &mb->pri_decisions[t];
+
+		if (d->nsel == nsel && !memcmp(d->sel, sel, nsel * sizeof(*sel)))
+			break;
+
+		if (!(d->ports & ~BIT(port)))
+			free = t;
+	}
+
+	if (t == RTL8365MB_NUM_PRI_DECISIONS) {
+		if (free < 0) {
+			dev_err(priv->dev,
+				"port %d: both priority decision tables are in use\n",
+				port);
+			return -EBUSY;
+		}
+
+		t = free;
+		d = &mb->pri_decisions[t];
+
+		ret = rtl8365mb_pri_decision_write(priv, t, sel, nsel);
+		if (ret)
+			return ret;
+
+		memcpy(d->sel, sel, nsel * sizeof(*sel));
+		d->nsel = nsel;
+	}
+
+	ret = regmap_update_bits(priv->map, RTL8365MB_QOS_PRI_DECISION_IDX_REG,
+				 BIT(port), t ? BIT(port) : 0);
+	if (ret)
+		return ret;
+
+	mb->pri_decisions[p->pri_decision].ports &= ~BIT(port);
+	d->ports |= BIT(port);
+	p->pri_decision = t;
+
+	return 0;
+}
+
+/* Frames are classified by their PCP and the port-based priority until
+ * told otherwise
+ */
+static int rtl8365mb_qos_setup(struct realtek_priv *priv)
+{
+	static const u8 sel_default[] = { DCB_APP_SEL_PCP };
+	struct rtl8365mb *mb = priv->chip_data;
+	struct dsa_switch *ds = &priv->ds;
+	int ret;
+	int i;
+
+	/* PCP values map to the internal priority of the same value */
+	for (i = 0; i < RTL8365MB_NUM_PRIORITIES; i++) {
+		ret = regmap_update_bits(priv->map,
+					 RTL8365MB_QOS_1Q_PRI_REMAP_REG(i),
+					 RTL8365MB_QOS_1Q_PRI_REMAP_MASK(i),
+					 i << RTL8365MB_QOS_1Q_PRI_REMAP_OFFSET(i));
+		if (ret)
+			return ret;
+	}
+
+	for (i = 0; i < RTL8365MB_NUM_DSCP; i++) {
+		ret = rtl8365mb_dscp_set_prio(priv, i, 0);
+		if (ret)
+			return ret;
+
+		mb->dscp_ports[i] = 0;
+	}
+
+	for (i = 0; i < RTL8365MB_NUM_PRI_DECISIONS; i++) {
+		struct rtl8365mb_pri_decision *d = &mb->pri_decisions[i];
+
+		ret = rtl8365mb_pri_decision_write(priv, i, sel_default,
+						   ARRAY_SIZE(sel_default));
+		if (ret)
+			return ret;
+
+		memcpy(d->sel, sel_default, sizeof(sel_default));
+		d->nsel = ARRAY_SIZE(sel_default);
+		d->ports = 0;
+	}
+
+	ret = regmap_write(priv->map, RTL8365MB_QOS_PRI_DECISION_IDX_REG, 0);
+	if (ret)
+		return ret;
+
+	for (i = 0; i < priv->num_ports; i++) {
+		if (dsa_is_unused_port(ds, i))
+			continue;
+
+		ret = rtl8365mb_port_set_default_prio(ds, i, 0);
+		if (ret)
+			return ret;
+
+		mb->ports[i].pri_decision = 0;
+
+		/* The CPU and DSA ports stay on table 0 without holding it,
+		 * or it could never be given another trust configuration
+		 */
+		if (dsa_is_user_port(ds, i))
+			mb->pri_decisions[0].ports |= BIT(i);
+	}
+
+	return 0;
+}
+
+static const char * const rtl8365mb_storm_names[] = {
+	[RTL8365MB_STORM_BCAST] = "broadcast",
+	[RTL8365MB_STORM_MCAST] = "multicast",
+	[RTL8365MB_STORM_UNKNOWN_MCAST] = "unknown multicast",
+	[RTL8365MB_STORM_UNKNOWN_UCAST] = "unknown unicast",
+};
+
+static int rtl8365mb_storm_port_set(struct realtek_priv *priv, int port,
+				    enum rtl8365mb_storm storm, int meter)
+{
+	struct rtl8365mb *mb = priv->chip_data;
+	struct rtl8365mb_port *p = &mb->ports[port];
+	int old = p->storm_meter[storm];
+	int ret;
+
+	if (meter >= 0) {
+		ret = regmap_update_bits(priv->map,
+					 RTL8365MB_STORM_METER_REG(storm, port),
+					 RTL8365MB_STORM_METER_MASK(port),
+					 meter << RTL8365MB_STORM_METER_OFFSET(port));
+		if (ret)
+			return ret;
+	}
+
+	ret = regmap_update_bits(priv->map, RTL8365MB_STORM_ENABLE_REG(storm),
+				 BIT(port), meter >= 0 ? BIT(port) : 0);
+	if (ret)
+		return ret;
+
+	WRITE_ONCE(p->storm_meter[storm], meter);
+
+	if (old >= 0)
+		rtl8365mb_meter_put(priv, old);
+
+	return 0;
+}
+
+/* Every user port gets a meter of its own, so that a storm entering one
+ * port does not starve the same traffic class on the others
+ */
+static int rtl8365mb_storm_set(struct realtek_priv *priv,
+			       enum rtl8365mb_storm storm, u32 kbps)
+{
+	u64 rate = div_u64((u64)kbps * 1000, 8);
+	struct rtl8365mb *mb = priv->chip_data;
+	int meters[RTL8365MB_MAX_NUM_PORTS];
+	struct dsa_switch *ds = &priv->ds;
+	struct dsa_port *dp;
+	u32 burst;
+	int ret;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(meters); i++)
+		meters[i] = -1;
+
+	burst = rtl8365mb_meter_burst(rate);
+
+	/* Get all meters first, so that running out of them leaves the old
+	 * configuration in place
+	 */
+	dsa_switch_for_each_user_port(dp, ds) {
+		if (!kbps)
+			break;
+
+		ret = rtl8365mb_meter_get(priv, rate, burst, NULL);
+		if (ret < 0) {
+			dev_err(priv->dev,
+				"failed to get %s storm control meter: %d\n",
+				rtl8365mb_storm_names[storm], ret);
+			goto err_put_meters;
+		}
+
+		meters[dp->index] = ret;
+	}
+
+	dsa_switch_for_each_user_port(dp, ds) {
+		ret = rtl8365mb_storm_port_set(priv, dp->index, storm,
+					       meters[dp->index]);
+		if (ret)
+			goto err_put_meters;
+
+		meters[dp->index] = -1;
+	}
+
+	mb->storm_kbps[storm] = kbps;
+
+	return 0;
+
+err_put_meters:
+	dsa_switch_for_each_user_port(dp, ds) {
+		if (meters[dp->index] >= 0)
+			rtl8365mb_meter_put(priv, meters[dp->index]);
+	}
+
+	return ret;
+}
+
+/* Meters keep dropping traffic for as long as a storm or a flood of control
+ * traffic lasts, so the exceed interrupt is masked once signalled and only
+ * unmasked a second later
+ */
+#define RTL8365MB_STORM_IRQ_HOLDOFF_JIFFIES	HZ
+
+static void rtl8365mb_storm_work(struct work_struct *work)
+{
+	struct rtl8365mb *mb = container_of(to_delayed_work(work),
+					    struct rtl8365mb, storm_work);
+	struct realtek_priv *priv = mb->priv;
+	int ret;
+
+	if (READ_ONCE(mb->storm_stopped))
+		return;
+
+	ret = regmap_update_bits(priv->map, RTL8365MB_INTR_CTRL_REG,
+				 RTL8365MB_INTR_METER_EXCEEDED_MASK,
+				 RTL8365MB_INTR_METER_EXCEEDED_MASK);
+	if (ret)
+		dev_err(priv->dev,
+			"failed to unmask meter exceed interrupt: %d\n", ret);
+}
+
+static void rtl8365mb_storm_init(struct realtek_priv *priv)
+{
+	struct rtl8365mb *mb = priv->chip_data;
+	int storm;
+	int i;
+
+	for (i = 0; i < RTL8365MB_MAX_NUM_PORTS; i++)
+		for (storm = 0; storm < RTL8365MB_STORM_END; storm++)
+			mb->ports[i].storm_meter[storm] = -1;
+
+	memset(mb->storm_kbps, 0, sizeof(mb->storm_kbps));
+	mb->storm_stopped = false;
+	INIT_DELAYED_WORK(&mb->storm_work, rtl8365mb_storm_work);
+}
+
+static void rtl8365mb_storm_teardown(struct realtek_priv *priv)
+{
+	int storm;
+
+	for (storm = 0; storm < RTL8365MB_STORM_END; storm++)
+		rtl8365mb_storm_set(priv, storm, 0);
+}
+
+static int rtl8365mb_flower_parse_police(const struct flow_action_entry *act,
+					 struct netlink_ext_ack *extack)
+{
+	if (act->police.exceed.act_id != FLOW_ACTION_DROP) {
+		NL_SET_ERR_MSG_MOD(extack,
+				   "Offload not supported when exceed action is not drop");
+		return -EOPNOTSUPP;
+	}
+
+	if (act->police.notexceed.act_id != FLOW_ACTION_PIPE &&
+	    act->police.notexceed.act_id != FLOW_ACTION_ACCEPT) {
+		NL_SET_ERR_MSG_MOD(extack,
+				   "Offload not supported when conform action is not pipe or ok");
+		return -EOPNOTSUPP;
+	}
+
+	if (act->police.rate_pkt_ps) {
+		NL_SET_ERR_MSG_MOD(extack,
+				   "Packets per second policing is not supported");
+		return -EOPNOTSUPP;
+	}
+
+	if (act->police.peakrate_bytes_ps || act->police.avrate ||
+	    act->police.overhead) {
+		NL_SET_ERR_MSG_MOD(extack,
+				   "Peakrate, avrate and overhead are not supported");
+		return -EOPNOTSUPP;
+	}
+
+	return 0;
+}
+
+static struct rtl8365mb_flower_rule *
+rtl8365mb_flower_rule_find(struct rtl8365mb *mb, int port,
+			   unsigned long cookie)
+{
+	struct rtl8365mb_flower_rule *rule;
+
+	list_for_each_entry(rule, &mb->flower_rules, list)
+		if (rule->port == port && rule->cookie == cookie)
+			return rule;
+
+	return NULL;
+}
+
+/* The templates cover MAC, IPv4, IPv6 source, IPv6 destination and L4
+ * matches. A flower rule must fit in a single template.
+ */
+static const u8 rtl8365mb_acl_templates[RTL8365MB_NUM_ACL_TEMPLATES]
+				       [RTL8365MB_ACL_NUM_FIELDS] = {
+	{
+		RTL8365MB_ACL_FIELD_DMAC0, RTL8365MB_ACL_FIELD_DMAC1,
+		RTL8365MB_ACL_FIELD_DMAC2, RTL8365MB_ACL_FIELD_SMAC0,
+		RTL8365MB_ACL_FIELD_SMAC1, RTL8365MB_ACL_FIELD_SMAC2,
+		RTL8365MB_ACL_FIELD_ETHERTYPE, RTL8365MB_ACL_FIELD_CTAG,
+	},
+	{
+		RTL8365MB_ACL_FIELD_IP4SIP0, RTL8365MB_ACL_FIELD_IP4SIP1,
+		RTL8365MB_ACL_FIELD_IP4DIP0, RTL8365MB_ACL_FIELD_IP4DIP1,
+		RTL8365MB_ACL_FIELD_SEL(RTL8365MB_ACL_SEL_IP4_PROTO),
+		RTL8365MB_ACL_FIELD_SEL(RTL8365MB_ACL_SEL_L4_SPORT),
+		RTL8365MB_ACL_FIELD_SEL(RTL8365MB_ACL_SEL_L4_DPORT),
+		RTL8365MB_ACL_FIELD_CTAG,
+	},
+	{
+		RTL8365MB_ACL_FIELD_IP6SIP0, RTL8365MB_ACL_FIELD_IP6SIP1,
+		RTL8365MB_ACL_FIELD_SEL(RTL8365MB_ACL_SEL_IP6_SIP + 0),
+		RTL8365MB_ACL_FIELD_SEL(RTL8365MB_ACL_SEL_IP6_SIP + 1),
+		RTL8365MB_ACL_FIELD_SEL(RTL8365MB_ACL_SEL_IP6_SIP + 2),
+		RTL8365MB_ACL_FIELD_SEL(RTL8365MB_ACL_SEL_IP6_SIP + 3),
+		RTL8365MB_ACL_FIELD_SEL(RTL8365MB_ACL_SEL_IP6_SIP + 4),
+		RTL8365MB_ACL_FIELD_SEL(RTL8365MB_ACL_SEL_IP6_SIP + 5),
+	},
+	{
+		RTL8365MB_ACL_FIELD_IP6DIP0, RTL8365MB_ACL_FIELD_IP6DIP1,
+		RTL8365MB_ACL_FIELD_SEL(RTL8365MB_ACL_SEL_IP6_DIP + 0),
+		RTL8365MB_ACL_FIELD_SEL(RTL8365MB_ACL_SEL_IP6_DIP + 1),
+		RTL8365MB_ACL_FIELD_SEL(RTL8365MB_ACL_SEL_IP6_DIP + 2),
+		RTL8365MB_ACL_FIELD_SEL(RTL8365MB_ACL_SEL_IP6_DIP + 3),
+		RTL8365MB_ACL_FIELD_SEL(RTL8365MB_ACL_SEL_IP6_DIP + 4),
+		RTL8365MB_ACL_FIELD_SEL(RTL8365MB_ACL_SEL_IP6_DIP + 5),
+	},
+	{
+		RTL8365MB_ACL_FIELD_ETHERTYPE, RTL8365MB_ACL_FIELD_CTAG,
+		RTL8365MB_ACL_FIELD_STAG,
+		RTL8365MB_ACL_FIELD_SEL(RTL8365MB_ACL_SEL_IP4_PROTO),
+		RTL8365MB_ACL_FIELD_SEL(RTL8365MB_ACL_SEL_IP6_NEXTHDR),
+		RTL8365MB_ACL_FIELD_SEL(RTL8365MB_ACL_SEL_L4_SPORT),
+		RTL8365MB_ACL_FIELD_SEL(RTL8365MB_ACL_SEL_L4_DPORT),
+		RTL8365MB_ACL_FIELD_UNUSED,
+	},
+};
+
+/* Offsets are in bytes from the start of the selected header */
+static const struct {
+	u8 format;
+	u8 offset;
+} rtl8365mb_acl_field_sels[RTL8365MB_ACL_NUM_FIELD_SELS] = {
+	[RTL8365MB_ACL_SEL_IP6_SIP + 0] = { RTL8365MB_ACL_FIELD_SEL_FORMAT_IPV6, 8 },
+	[RTL8365MB_ACL_SEL_IP6_SIP + 1] = { RTL8365MB_ACL_FIELD_SEL_FORMAT_IPV6, 10 },
+	[RTL8365MB_ACL_SEL_IP6_SIP + 2] = { RTL8365MB_ACL_FIELD_SEL_FORMAT_IPV6, 12 },
+	[RTL8365MB_ACL_SEL_IP6_SIP + 3] = { RTL8365MB_ACL_FIELD_SEL_FORMAT_IPV6, 14 },
+	[RTL8365MB_ACL_SEL_IP6_SIP + 4] = { RTL8365MB_ACL_FIELD_SEL_FORMAT_IPV6, 16 },
+	[RTL8365MB_ACL_SEL_IP6_SIP + 5] = { RTL8365MB_ACL_FIELD_SEL_FORMAT_IPV6, 18 },
+	[RTL8365MB_ACL_SEL_IP6_DIP + 0] = { RTL8365MB_ACL_FIELD_SEL_FORMAT_IPV6, 24 },
+	[RTL8365MB_ACL_SEL_IP6_DIP + 1] = { RTL8365MB_ACL_FIELD_SEL_FORMAT_IPV6, 26 },
+	[RTL8365MB_ACL_SEL_IP6_DIP + 2] = { RTL8365MB_ACL_FIELD_SEL_FORMAT_IPV6, 28 },
+	[RTL8365MB_ACL_SEL_IP6_DIP + 3] = { RTL8365MB_ACL_FIELD_SEL_FORMAT_IPV6, 30 },
+	[RTL8365MB_ACL_SEL_IP6_DIP + 4] = { RTL8365MB_ACL_FIELD_SEL_FORMAT_IPV6, 32 },
+	[RTL8365MB_ACL_SEL_IP6_DIP + 5] = { RTL8365MB_ACL_FIELD_SEL_FORMAT_IPV6, 34 },
+	/* TTL and protocol */
+	[RTL8365MB_ACL_SEL_IP4_PROTO] = { RTL8365MB_ACL_FIELD_SEL_FORMAT_IPV4, 8 },
+	[RTL8365MB_ACL_SEL_L4_SPORT] = { RTL8365MB_ACL_FIELD_SEL_FORMAT_IP_PAYLOAD, 0 },
+	[RTL8365MB_ACL_SEL_L4_DPORT] = { RTL8365MB_ACL_FIELD_SEL_FORMAT_IP_PAYLOAD, 2 },
+	/* Next header and hop limit */
+	[RTL8365MB_ACL_SEL_IP6_NEXTHDR] = { RTL8365MB_ACL_FIELD_SEL_FORMAT_IPV6, 6 },
+};
+
+/**
+ * struct rtl8365mb_acl_match - flower match compiled into ACL fields
+ * @tags: headers the frame must contain, RTL8365MB_ACL_TAG_*
+ * @num_keys: number of used entries in @field, @data and @care
+ * @field: field types to match on
+ * @data: value of each field
+ * @care: mask of each field
+ */
+struct rtl8365mb_acl_match {
+	u8 tags;
+	unsigned int num_keys;
+	u8 field[2 * RTL8365MB_ACL_NUM_FIELDS];
+	u16 data[2 * RTL8365MB_ACL_NUM_FIELDS];
+	u16 care[2 * RTL8365MB_ACL_NUM_FIELDS];
+};
+
+static int rtl8365mb_acl_match_add(struct rtl8365mb_acl_match *m, u8 field,
+				   u16 data, u16 care,
+				   struct netlink_ext_ack *extack)
+{
+	if (!care)
+		return 0;
+
+	if (m->num_keys == ARRAY_SIZE(m->field)) {
+		NL_SET_ERR_MSG_MOD(extack, "Too many fields to match on");
+		return -EOPNOTSUPP;
+	}
+
+	m->field[m->num_keys] = field;
+	m->data[m->num_keys] = data & care;
+	m->care[m->num_keys] = care;
+	m->num_keys++;
+
+	return 0;
+}
+
+static int rtl8365mb_acl_match_mac(struct rtl8365mb_acl_match *m, u8 field,
+				   const u8 *addr, const u8 *mask,
+				   struct netlink_ext_ack *extack)
+{
+	int ret;
+	int i;
+
+	/* Field 0 holds the last two bytes of the address */
+	for (i = 0; i < ETH_ALEN / 2; i++) {
+		ret = rtl8365mb_acl_match_add(m, field + i,
+					      addr[4 - 2 * i] << 8 | addr[5 - 2 * i],
+					      mask[4 - 2 * i] << 8 | mask[5 - 2 * i],
+					      extack);
+		if (ret)
+			return ret;
+	}
+
+	return 0;
+}
+
+static int rtl8365mb_acl_match_ip6(struct rtl8365mb_acl_match *m, u8 field,
+				   u8 sel, const struct in6_addr *addr,
+				   const struct in6_addr *mask,
+				   struct netlink_ext_ack *extack)
+{
+	int ret;
+	int i;
+
+	/* Bits 31-0 in dedicated fields, the rest through field selectors */
+	for (i = 0; i < 8; i++) {
+		u8 f = i < 6 ? RTL8365MB_ACL_FIELD_SEL(sel + i) : field + 7 - i;
+
+		ret = rtl8365mb_acl_match_add(m, f, ntohs(addr->s6_addr16[i]),
+					      ntohs(mask->s6_addr16[i]), extack);
+		if (ret)
+			return ret;
+	}
+
+	return 0;
+}
+
+static int rtl8365mb_acl_parse_match(struct flow_rule *rule,
+				     struct rtl8365mb_acl_match *m,
+				     struct netlink_ext_ack *extack)
+{
+	struct flow_dissector *dissector = rule->match.dissector;
+	u16 n_proto = 0;
+	u8 ip_proto = 0;
+	int ret;
+
+	if (dissector->used_keys &
+	    ~(BIT_ULL(FLOW_DISSECTOR_KEY_BASIC) |
+	      BIT_ULL(FLOW_DISSECTOR_KEY_CONTROL) |
+	      BIT_ULL(FLOW_DISSECTOR_KEY_ETH_ADDRS) |
+	      BIT_ULL(FLOW_DISSECTOR_KEY_VLAN) |
+	      BIT_ULL(FLOW_DISSECTOR_KEY_IPV4_ADDRS) |
+	      BIT_ULL(FLOW_DISSECTOR_KEY_IPV6_ADDRS) |
+	      BIT_ULL(FLOW_DISSECTOR_KEY_PORTS))) {
+		NL_SET_ERR_MSG_MOD(extack, "Unsupported keys used");
+		return -EOPNOTSUPP;
+	}
+
+	if (flow_rule_match_has_control_flags(rule, extack))
+		return -EOPNOTSUPP;
+
+	if (flow_rule_match_key(rule, FLOW_DISSECTOR_KEY_BASIC)) {
+		struct flow_match_basic match;
+
+		flow_rule_match_basic(rule, &match);
+		if (match.mask->n_proto) {
+			if (match.mask->n_proto != htons(0xFFFF)) {
+				NL_SET_ERR_MSG_MOD(extack,
+						   "Only an exact protocol match is supported");
+				return -EOPNOTSUPP;
+			}
+			n_proto = ntohs(match.key->n_proto);
+		}
+
+		if (match.mask->ip_proto) {
+			if (match.mask->ip_proto != 0xFF) {
+				NL_SET_ERR_MSG_MOD(extack,
+						   "Only an exact IP protocol match is supported");
+				return -EOPNOTSUPP;
+			}
+			ip_proto = match.key->ip_proto;
+		}
+	}
+
+	/* IPv4, IPv6 and VLAN tagged frames are told apart by the tag exist
+	 * bits, which leaves the EtherType field to other protocols
+	 */
+	switch (n_proto) {
+	case 0:
+		break;
+	case ETH_P_IP:
+		m->tags |= RTL8365MB_ACL_TAG_IPV4;
+		break;
+	case ETH_P_IPV6:
+		m->tags |= RTL8365MB_ACL_TAG_IPV6;
+		break;
+	case ETH_P_8021Q:
+		m->tags |= RTL8365MB_ACL_TAG_CTAG;
+		break;
+	case ETH_P_8021AD:
+		m->tags |= RTL8365MB_ACL_TAG_STAG;
+		break;
+	default:
+		ret = rtl8365mb_acl_match_add(m, RTL8365MB_ACL_FIELD_ETHERTYPE,
+					      n_proto, 0xFFFF, extack);
+		if (ret)
+			return ret;
+	}
+
+	if (ip_proto) {
+		if (n_proto == ETH_P_IP)
+			ret = rtl8365mb_acl_match_add(m,
+						      RTL8365MB_ACL_FIELD_SEL(RTL8365MB_ACL_SEL_IP4_PROTO),
+						      ip_proto, 0x00FF, extack);
+		else if (n_proto == ETH_P_IPV6)
+			ret = rtl8365mb_acl_match_add(m,
+						      RTL8365MB_ACL_FIELD_SEL(RTL8365MB_ACL_SEL_IP6_NEXTHDR),
+						      ip_proto << 8, 0xFF00, extack);
+		else
+			ret = -EOPNOTSUPP;
+
+		if (ret) {
+			NL_SET_ERR_MSG_MOD(extack,
+					   "IP protocol match requires protocol ip or ipv6");
+			return ret;
+		}
+	}
+
+	if (flow_rule_match_key(rule, FLOW_DISSECTOR_KEY_ETH_ADDRS)) {
+		struct flow_match_eth_addrs match;
+
+		flow_rule_match_eth_addrs(rule, &match);
+		ret = rtl8365mb_acl_match_mac(m, RTL8365MB_ACL_FIELD_DMAC0,
+					      match.key->dst, match.mask->dst,
+					      extack);
+		if (ret)
+			return ret;
+
+		ret = rtl8365mb_acl_match_mac(m, RTL8365MB_ACL_FIELD_SMAC0,
+					      match.key->src, match.mask->src,
+					      extack);
+		if (ret)
+			return ret;
+	}
+
+	if (flow_rule_match_key(rule, FLOW_DISSECTOR_KEY_VLAN)) {
+		struct flow_match_vlan match;
+		u16 data;
+		u16 care;
+
+		flow_rule_match_vlan(rule, &match);
+		data = match.key->vlan_id |
+		       match.key->vlan_dei << VLAN_CFI_SHIFT |
+		       match.key->vlan_priority << VLAN_PRIO_SHIFT;
+		care = match.mask->vlan_id |
+		       match.mask->vlan_dei << VLAN_CFI_SHIFT |
+		       match.mask->vlan_priority << VLAN_PRIO_SHIFT;
+
+		m->tags |= RTL8365MB_ACL_TAG_CTAG;
+		ret = rtl8365mb_acl_match_add(m, RTL8365MB_ACL_FIELD_CTAG, data,
+					      care, extack);
+		if (ret)
+			return ret;
+	}
+
+	if (flow_rule_match_key(rule, FLOW_DISSECTOR_KEY_IPV4_ADDRS)) {
+		struct flow_match_ipv4_addrs match;
+		u32 addr;
+		u32 mask;
+
+		if (n_proto != ETH_P_IP) {
+			NL_SET_ERR_MSG_MOD(extack,
+					   "IPv4 address match requires protocol ip");
+			return -EOPNOTSUPP;
+		}
+
+		flow_rule_match_ipv4_addrs(rule, &match);
+
+		addr = ntohl(match.key->src);
+		mask = ntohl(match.mask->src);
+		ret = rtl8365mb_acl_match_add(m, RTL8365MB_ACL_FIELD_IP4SIP0,
+					      addr, mask, extack) ?:
+		      rtl8365mb_acl_match_add(m, RTL8365MB_ACL_FIELD_IP4SIP1,
+					      addr >> 16, mask >> 16, extack);
+		if (ret)
+			return ret;
+
+		addr = ntohl(match.key->dst);
+		mask = ntohl(match.mask->dst);
+		ret = rtl8365mb_acl_match_add(m, RTL8365MB_ACL_FIELD_IP4DIP0,
+					      addr, mask, extack) ?:
+		      rtl8365mb_acl_match_add(m, RTL8365MB_ACL_FIELD_IP4DIP1,
+					      addr >> 16, mask >> 16, extack);
+		if (ret)
+			return ret;
+	}
+
+	if (flow_rule_match_key(rule, FLOW_DISSECTOR_KEY_IPV6_ADDRS)) {
+		struct flow_match_ipv6_addrs match;
+
+		if (n_proto != ETH_P_IPV6) {
+			NL_SET_ERR_MSG_MOD(extack,
+					   "IPv6 address match requires protocol ipv6");
+			return -EOPNOTSUPP;
+		}
+
+		flow_rule_match_ipv6_addrs(rule, &match);
+		ret = rtl8365mb_acl_match_ip6(m, RTL8365MB_ACL_FIELD_IP6SIP0,
+					      RTL8365MB_ACL_SEL_IP6_SIP,
+					      &match.key->src, &match.mask->src,
+					      extack);
+		if (ret)
+			return ret;
+
+		ret = rtl8365mb_acl_match_ip6(m, RTL8365MB_ACL_FIELD_IP6DIP0,
+					      RTL8365MB_ACL_SEL_IP6_DIP,
+					      &match.key->dst, &match.mask->dst,
+					      extack);
+		if (ret)
+			return ret;
+	}
+
+	if (flow_rule_match_key(rule, FLOW_DISSECTOR_KEY_PORTS)) {
+		struct flow_match_ports match;
+
+		if (ip_proto != IPPROTO_TCP && ip_proto != IPPROTO_UDP) {
+			NL_SET_ERR_MSG_MOD(extack,
+					   "L4 port match requires ip_proto tcp or udp");
+			return -EOPNOTSUPP;
+		}
+
+		flow_rule_match_ports(rule, &match);
+		ret = rtl8365mb_acl_match_add(m,
+					      RTL8365MB_ACL_FIELD_SEL(RTL8365MB_ACL_SEL_L4_SPORT),
+					      ntohs(match.key->src),
+					      ntohs(match.mask->src), extack) ?:
+		      rtl8365mb_acl_match_add(m,
+					      RTL8365MB_ACL_FIELD_SEL(RTL8365MB_ACL_SEL_L4_DPORT),
+					      ntohs(match.key->dst),
+					      ntohs(match.mask->dst), extack);
+		if (ret)
+			return ret;
+	}
+
+	return 0;
+}
+
+/* Place the fields of @m in the first template containing all of them */
+static void rtl8365mb_acl_set_pmask(struct rtl8365mb_acl_rule *acl, u32 pmask)
+{
+	acl->pmask = pmask;
+	acl->data[0] &= ~RTL8365MB_ACL_RULE_CONF0_PMSK_LS_MASK;
+	acl->data[0] |= FIELD_PREP(RTL8365MB_ACL_RULE_CONF0_PMSK_LS_MASK,
+				   pmask & 0xFF);
+	acl->data[9] &= ~RTL8365MB_ACL_RULE_CONF9_PMSK_MS_MASK;
+	acl->data[9] |= FIELD_PREP(RTL8365MB_ACL_RULE_CONF9_PMSK_MS_MASK,
+				   pmask >> 8);
+}
+
+static int rtl8365mb_acl_compile_match(struct rtl8365mb_acl_rule *acl,
+				       const struct rtl8365mb_acl_match *m,
+				       u32 pmask, struct netlink_ext_ack *extack)
+{
+	int slot[ARRAY_SIZE(m->field)];
+	unsigned int i;
+	int t;
+	int f;
+
+	for (t = 0; t < RTL8365MB_NUM_ACL_TEMPLATES; t++) {
+		for (i = 0; i < m->num_keys; i++) {
+			for (f = 0; f < RTL8365MB_ACL_NUM_FIELDS; f++)
+				if (rtl8365mb_acl_templates[t][f] == m->field[i])
+					break;
+
+			if (f == RTL8365MB_ACL_NUM_FIELDS)
+				break;
+
+			slot[i] = f;
+		}
+
+		if (i == m->num_keys)
+			break;
+	}
+
+	if (t == RTL8365MB_NUM_ACL_TEMPLATES) {
+		NL_SET_ERR_MSG_MOD(extack,
+				   "Combination of matches not supported by any ACL template");
+		return -EOPNOTSUPP;
+	}
+
+	memset(acl->data, 0, sizeof(acl->data));
+	memset(acl->care, 0, sizeof(acl->care));
+
+	for (i = 0; i < m->num_keys; i++) {
+		acl->data[1 + slot[i]] |= m->data[i];
+		acl->care[1 + slot[i]] |= m->care[i];
+	}
+
+	acl->data[0] = FIELD_PREP(RTL8365MB_ACL_RULE_CONF0_TYPE_MASK, t) |
+		       FIELD_PREP(RTL8365MB_ACL_RULE_CONF0_TAG_EXIST_MASK,
+				  m->tags);
+	acl->care[0] = RTL8365MB_ACL_RULE_CONF0_TYPE_MASK |
+		       FIELD_PREP(RTL8365MB_ACL_RULE_CONF0_TAG_EXIST_MASK,
+				  m->tags) |
+		       RTL8365MB_ACL_RULE_CONF0_PMSK_LS_MASK;
+	acl->data[9] = RTL8365MB_ACL_RULE_CONF9_VALID_MASK;
+	acl->care[9] = RTL8365MB_ACL_RULE_CONF9_PMSK_MS_MASK;
+	rtl8365mb_acl_set_pmask(acl, pmask);
+
+	return 0;
+}
+
+static int rtl8365mb_flower_port(struct dsa_switch *ds, struct net_device *dev,
+				 struct netlink_ext_ack *extack)
+{
+	struct dsa_port *dp;
+
+	if (!dev || !dsa_user_dev_check(dev)) {
+		NL_SET_ERR_MSG_MOD(extack,
+				   "Destination is not a port of this switch");
+		return -EOPNOTSUPP;
+	}
+
+	dp = dsa_port_from_netdev(dev);
+	if (IS_ERR(dp) || dp->ds != ds) {
+		NL_SET_ERR_MSG_MOD(extack,
+				   "Destination is not a port of this switch");
+		return -EOPNOTSUPP;
+	}
+
+	return dp->index;
+}
+
+static int rtl8365mb_acl_set_fwd(struct rtl8365mb_acl_rule *acl,
+				 enum rtl8365mb_acl_fwd_act fwd, u32 pmask,
+				 struct netlink_ext_ack *extack)
+{
+	if (acl->act_ctrl & RTL8365MB_ACL_ACTION_FORWARD) {
+		NL_SET_ERR_MSG_MOD(extack,
+				   "Only one of drop, trap, redirect and mirror is supported");
+		return -EOPNOTSUPP;
+	}
+
+	acl->act_ctrl |= RTL8365MB_ACL_ACTION_FORWARD;
+	acl->act[1] |= FIELD_PREP(RTL8365MB_ACL_ACT_CONF1_FWD_PMSK_LS_MASK,
+				  pmask & 0xFF);
+	acl->act[2] |= FIELD_PREP(RTL8365MB_ACL_ACT_CONF2_FWD_ACT_MASK, fwd);
+	acl->act[3] |= FIELD_PREP(RTL8365MB_ACL_ACT_CONF3_FWD_PMSK_MS_MASK,
+				  pmask >> 8);
+
+	return 0;
+}
+
+/* A police action gets a meter of its own, which is taken last since meters
+ * are shared with other features
+ */
+static int rtl8365mb_acl_parse_action(struct dsa_switch *ds,
+				      struct rtl8365mb_acl_rule *acl,
+				      struct flow_rule *rule,
+				      const struct flow_action_entry **police,
+				      struct netlink_ext_ack *extack)
+{
+	const struct flow_action_entry *act;
+	int port;
+	int ret;
+	int i;
+
+	memset(acl->act, 0, sizeof(acl->act));
+	acl->act_ctrl = 0;
+	*police = NULL;
+
+	if (!flow_action_basic_hw_stats_check(&rule->action, extack))
+		return -EOPNOTSUPP;
+
+	flow_action_for_each(i, act, &rule->action) {
+		switch (act->id) {
+		case FLOW_ACTION_ACCEPT:
+			break;
+		case FLOW_ACTION_DROP:
+			/* Redirect to no port */
+			ret = rtl8365mb_acl_set_fwd(acl, RTL8365MB_ACL_FWD_REDIRECT,
+						    0, extack);
+			break;
+		case FLOW_ACTION_TRAP:
+			ret = rtl8365mb_acl_set_fwd(acl, RTL8365MB_ACL_FWD_TRAP,
+						    0, extack);
+			break;
+		case FLOW_ACTION_REDIRECT:
+		case FLOW_ACTION_MIRRED:
+			port = rtl8365mb_flower_port(ds, act->dev, extack);
+			if (port < 0)
+				return port;
+
+			ret = rtl8365mb_acl_set_fwd(acl,
+						    act->id == FLOW_ACTION_REDIRECT ?
+						    RTL8365MB_ACL_FWD_REDIRECT :
+						    RTL8365MB_ACL_FWD_COPY,
+						    BIT(port), extack);
+			break;
+		case FLOW_ACTION_PRIORITY:
+			if (act->priority >= RTL8365MB_NUM_PRIORITIES) {
+				NL_SET_ERR_MSG_FMT_MOD(extack,
+						       "Priority must be less than %d",
+						       RTL8365MB_NUM_PRIORITIES);
+				return -EOPNOTSUPP;
+			}
+
+			acl->act_ctrl |= RTL8365MB_ACL_ACTION_PRIORITY;
+			acl->act[2] |=
+				FIELD_PREP(RTL8365MB_ACL_ACT_CONF2_PRI_MASK,
+					   act->priority) |
+				FIELD_PREP(RTL8365MB_ACL_ACT_CONF2_PRI_ACT_MASK,
+					   RTL8365MB_ACL_PRI_ACT_INTERNAL);
+			ret = 0;
+			break;
+		case FLOW_ACTION_POLICE:
+			if (*police) {
+				NL_SET_ERR_MSG_MOD(extack,
+						   "Only one police action is supported");
+				return -EOPNOTSUPP;
+			}
+
+			ret = rtl8365mb_flower_parse_police(act, extack);
+			*police = act;
+			break;
+		default:
+			NL_SET_ERR_MSG_MOD(extack, "Action not supported");
+			return -EOPNOTSUPP;
+		}
+
+		if (ret)
+			return ret;
+	}
+
+	return 0;
+}
+
+static int rtl8365mb_acl_write(struct realtek_priv *priv,
+			       struct rtl8365mb_acl_rule *acl)
+{
+	int ret;
+
+	/* Actions first, so that the rule never hits with stale actions */
+	ret = rtl8365mb_table_access(priv, RTL8365MB_TABLE_ACL_ACT,
+				     RTL8365MB_TABLE_WRITE, acl->index,
+				     acl->act);
+	if (ret)
+		return ret;
+
+	ret = regmap_update_bits(priv->map,
+				 RTL8365MB_ACL_ACTION_CTRL_REG(acl->index),
+				 RTL8365MB_ACL_ACTION_CTRL_MASK(acl->index),
+				 acl->act_ctrl << (acl->index & 1 ? 8 : 0));
+	if (ret)
+		return ret;
+
+	ret = rtl8365mb_table_access(priv, RTL8365MB_TABLE_ACL_RULE,
+				     RTL8365MB_TABLE_WRITE,
+				     RTL8365MB_ACL_RULE_ADDR(acl->index, 1),
+				     acl->care);
+	if (ret)
+		return ret;
+
+	/* The data bits carry the valid bit */
+	return rtl8365mb_table_access(priv, RTL8365MB_TABLE_ACL_RULE,
+				      RTL8365MB_TABLE_WRITE,
+				      RTL8365MB_ACL_RULE_ADDR(acl->index, 0),
+				      acl->data);
+}
+
+static int rtl8365mb_acl_clear(struct realtek_priv *priv, int index)
+{
+	u16 entry[RTL8365MB_ACL_RULE_ENTRY_SIZE] = {};
+	int ret;
+
+	/* Invalidate the rule before dropping its care bits and actions */
+	ret = rtl8365mb_table_access(priv, RTL8365MB_TABLE_ACL_RULE,
+				     RTL8365MB_TABLE_WRITE,
+				     RTL8365MB_ACL_RULE_ADDR(index, 0), entry);
+	if (ret)
+		return ret;
+
+	ret = rtl8365mb_table_access(priv, RTL8365MB_TABLE_ACL_RULE,
+				     RTL8365MB_TABLE_WRITE,
+				     RTL8365MB_ACL_RULE_ADDR(index, 1), entry);
+	if (ret)
+		return ret;
+
+	return regmap_update_bits(priv->map, RTL8365MB_ACL_ACTION_CTRL_REG(index),
+				  RTL8365MB_ACL_ACTION_CTRL_MASK(index), 0);
+}
+
+/* Both counters of a pair are latched by one MIB address. The caller must
+ * hold mib_lock.
+ */
+static int rtl8365mb_acl_counter_read(struct realtek_priv *priv, int n,
+				      u32 *packets, u32 *bytes)
+{
+	u32 val[4];
+	int ret;
+	int i;
+
+	ret = regmap_write(priv->map, RTL8365MB_MIB_ADDRESS_REG,
+			   RTL8365MB_MIB_LOG_CNT_ADDRESS(n));
+	if (ret)
+		return ret;
+
+	ret = regmap_read_poll_timeout(priv->map, RTL8365MB_MIB_CTRL0_REG,
+				       val[0],
+				       !(val[0] & RTL8365MB_MIB_CTRL0_BUSY_MASK),
+				       10, 100);
+	if (ret)
+		return ret;
+
+	if (val[0] & RTL8365MB_MIB_CTRL0_RESET_MASK)
+		return -EIO;
+
+	for (i = 0; i < ARRAY_SIZE(val); i++) {
+		ret = regmap_read(priv->map, RTL8365MB_MIB_COUNTER_REG(i),
+				  &val[i]);
+		if (ret)
+			return ret;
+	}
+
+	*packets = (val[1] << 16) | (val[0] & 0xFFFF);
+	*bytes = (val[3] << 16) | (val[2] & 0xFFFF);
+
+	return 0;
+}
+
+/* The caller must hold acl_counter_lock */
+static void rtl8365mb_acl_counter_update(struct realtek_priv *priv, int n)
+{
+	struct rtl8365mb *mb = priv->chip_data;
+	struct rtl8365mb_acl_counter *c = &mb->acl_counters[n];
+	u32 packets;
+	u32 bytes;
+	int ret;
+
+	mutex_lock(&mb->mib_lock);
+	ret = rtl8365mb_acl_counter_read(priv, n, &packets, &bytes);
+	mutex_unlock(&mb->mib_lock);
+	if (ret)
+		return;
+
+	/* The counters wrap, but not within a polling interval */
+	if (packets != c->hw_packets)
+		c->lastused = jiffies;
+
+	c->packets += (u32)(packets - c->hw_packets);
+	c->bytes += (u32)(bytes - c->hw_bytes);
+	c->hw_packets = packets;
+	c->hw_bytes = bytes;
+}
+
+static int rtl8365mb_acl_counter_get(struct realtek_priv *priv)
+{
+	struct rtl8365mb *mb = priv->chip_data;
+	struct rtl8365mb_acl_counter *c;
+	u32 packets;
+	u32 bytes;
+	int ret;
+	int n;
+
+	mutex_lock(&mb->acl_counter_lock);
+
+	for (n = 0; n < RTL8365MB_NUM_LOG_CNT_PAIRS; n++)
+		if (!mb->acl_counters[n].used)
+			break;
+
+	if (n == RTL8365MB_NUM_LOG_CNT_PAIRS) {
+		ret = -ENOSPC;
+		goto out;
+	}
+
+	/* The counters are never cleared, count from their current value */
+	mutex_lock(&mb->mib_lock);
+	ret = rtl8365mb_acl_counter_read(priv, n, &packets, &bytes);
+	mutex_unlock(&mb->mib_lock);
+	if (ret)
+		goto out;
+
+	c = &mb->acl_counters[n];
+	memset(c, 0, sizeof(*c));
+	c->used = true;
+	c->hw_packets = packets;
+	c->hw_bytes = bytes;
+	c->lastused = jiffies;
+	ret = n;
+
+out:
+	mutex_unlock(&mb->acl_counter_lock);
+
+	return ret;
+}
+
+static void rtl8365mb_acl_counter_put(struct realtek_priv *priv, int n)
+{
+	struct rtl8365mb *mb = priv->chip_data;
+
+	mutex_lock(&mb->acl_counter_lock);
+	mb->acl_counters[n].used = false;
+	mutex_unlock(&mb->acl_counter_lock);
+}
+
+/* Only the counter pairs in use are read, one MIB access each, and the
+ * flower stats are answered from the values collected here.
+ */
+static void rtl8365mb_acl_stats_poll(struct work_struct *work)
+{
+	struct rtl8365mb *mb = container_of(to_delayed_work(work),
+					    struct rtl8365mb, acl_stats_work);
+	int n;
+
+	mutex_lock(&mb->acl_counter_lock);
+	for (n = 0; n < RTL8365MB_NUM_LOG_CNT_PAIRS; n++)
+		if (mb->acl_counters[n].used)
+			rtl8365mb_acl_counter_update(mb->priv, n);
+	mutex_unlock(&mb->acl_counter_lock);
+
+	schedule_delayed_work(&mb->acl_stats_work,
+			      RTL8365MB_STATS_INTERVAL_JIFFIES);
+}
+
+/* Move a rule to the free entry @to. The copy at the new entry is complete
+ * before the old entry is invalidated, so traffic hits one copy of the rule or
+ * the other but is never left without it.
+ */
+static int rtl8365mb_acl_move(struct realtek_priv *priv,
+			      struct rtl8365mb_acl_rule *acl, int to)
+{
+	struct rtl8365mb *mb = priv->chip_data;
+	int from = acl->index;
+	int ret;
+
+	acl->index = to;
+	ret = rtl8365mb_acl_write(priv, acl);
+	if (ret) {
+		rtl8365mb_acl_clear(priv, to);
+		acl->index = from;
+		return ret;
+	}
+
+	mb->acl_rules[to] = acl;
+	mb->acl_rules[from] = NULL;
+
+	return rtl8365mb_acl_clear(priv, from);
+}
+
+/* Rules are looked up in index order, so a rule must sit after all rules of
+ * higher precedence and before all rules of lower precedence. New rules go in
+ * the middle of the free gap between the two, which leaves room on both sides
+ * for rules of neighbouring priority. When there is no gap, the rules between
+ * the insertion point and the nearest free entry are shifted by one to open
+ * one, so that the table only fills up when all of its entries are in use.
+ */
+static int rtl8365mb_acl_index_alloc(struct realtek_priv *priv, u32 prio,
+				     struct netlink_ext_ack *extack)
+{
+	struct rtl8365mb *mb = priv->chip_data;
+	int last = RTL8365MB_NUM_ACL_RULES - 1;
+	int first = 0;
+	int below;
+	int above;
+	int ret;
+	int i;
+
+	for (i = 0; i < RTL8365MB_NUM_ACL_RULES; i++) {
+		struct rtl8365mb_acl_rule *acl = mb->acl_rules[i];
+
+		if (!acl)
+			continue;
+
+		if (acl->prio <= prio) {
+			first = i + 1;
+		} else {
+			last = i - 1;
+			break;
+		}
+	}
+
+	if (first <= last)
+		return first + (last - first) / 2;
+
+	/* Entry first - 1 holds a rule of higher precedence and entry first a
+	 * rule of lower precedence: look for the closest free entry on either
+	 * side.
+	 */
+	for (below = first - 1; below >= 0 && mb->acl_rules[below]; below--)
+		;
+	for (above = first; above < RTL8365MB_NUM_ACL_RULES &&
+	     mb->acl_rules[above]; above++)
+		;
+
+	if (below < 0 && above == RTL8365MB_NUM_ACL_RULES) {
+		NL_SET_ERR_MSG_MOD(extack, "ACL is full");
+		return -ENOSPC;
+	}
+
+	if (above < RTL8365MB_NUM_ACL_RULES &&
+	    (below < 0 || above - first < first - below)) {
+		for (i = above - 1; i >= first; i--) {
+			ret = rtl8365mb_acl_move(priv, mb->acl_rules[i], i + 1);
+			if (ret)
+				goto err_move;
+		}
+
+		return first;
+	}
+
+	for (i = below + 1; i < first; i++) {
+		ret = rtl8365mb_acl_move(priv, mb->acl_rules[i], i - 1);
+		if (ret)
+			goto err_move;
+	}
+
+	return first - 1;
+
+err_move:
+	NL_SET_ERR_MSG_MOD(extack, "Failed to move ACL entry");
+
+	return ret;
+}
+
+static u64 rtl8365mb_acl_occ_get(void *priv)
+{
+	struct rtl8365mb *mb = ((struct realtek_priv *)priv)->chip_data;
+	u64 occ = 0;
+	int i;
+
+	mutex_lock(&mb->acl_lock);
+	for (i = 0; i < RTL8365MB_NUM_ACL_RULES; i++)
+		if (mb->acl_rules[i])
+			occ++;
+	mutex_unlock(&mb->acl_lock);
+
+	return occ;
+}
+
+/* Flower rules sharing a tc police action are policed as one aggregate. A
+ * rule with the same match as a rule sharing its police action on other
+ * ports is merged into that rule's entry, which then matches all of their
+ * ports. A rule with another match gets an entry of its own that shares the
+ * meter.
+ */
+static struct rtl8365mb_acl_rule *
+rtl8365mb_acl_police_find(struct rtl8365mb *mb, struct rtl8365mb_acl_rule *acl,
+			  bool same_match)
+{
+	struct rtl8365mb_flower_rule *rule;
+	struct rtl8365mb_acl_rule *other;
+	struct rtl8365mb_acl_rule tmp;
+
+	list_for_each_entry(rule, &mb->flower_rules, list) {
+		other = rule->acl;
+
+		if (other->meter < 0 ||
+		    other->police_index != acl->police_index)
+			continue;
+
+		if (!same_match)
+			return other;
+
+		if (other->prio != acl->prio || other->pmask & acl->pmask)
+			continue;
+
+		tmp = *acl;
+		rtl8365mb_acl_set_pmask(&tmp, other->pmask);
+		tmp.act_ctrl |= RTL8365MB_ACL_ACTION_POLICING;
+		tmp.act[1] |= FIELD_PREP(RTL8365MB_ACL_ACT_CONF1_METER_IDX_MASK,
+					 other->meter);
+
+		if (!memcmp(tmp.data, other->data, sizeof(tmp.data)) &&
+		    !memcmp(tmp.care, other->care, sizeof(tmp.care)) &&
+		    !memcmp(tmp.act, other->act, sizeof(tmp.act)) &&
+		    tmp.act_ctrl == other->act_ctrl)
+			return other;
+	}
+
+	return NULL;
+}
+
+static int rtl8365mb_acl_port_join(struct realtek_priv *priv,
+				   struct rtl8365mb_acl_rule *acl, int port,
+				   struct netlink_ext_ack *extack)
+{
+	u32 pmask = acl->pmask;
+	int ret;
+
+	rtl8365mb_acl_set_pmask(acl, pmask | BIT(port));
+	ret = rtl8365mb_acl_write(priv, acl);
+	if (ret) {
+		NL_SET_ERR_MSG_MOD(extack, "Failed to write ACL entry");
+		rtl8365mb_acl_set_pmask(acl, pmask);
+		rtl8365mb_acl_write(priv, acl);
+	}
+
+	return ret;
+}
+
+static struct rtl8365mb_acl_rule *
+rtl8365mb_acl_rule_add(struct dsa_switch *ds, int port,
+		       struct flow_cls_offload *cls)
+{
+	struct flow_rule *flow = flow_cls_offload_flow_rule(cls);
+	struct netlink_ext_ack *extack = cls->common.extack;
+	const struct flow_action_entry *police;
+	struct realtek_priv *priv = ds->priv;
+	struct rtl8365mb *mb = priv->chip_data;
+	struct rtl8365mb_acl_match match = {};
+	struct rtl8365mb_acl_rule *shared;
+	struct rtl8365mb_acl_rule *acl;
+	int ret;
+
+	acl = kzalloc(sizeof(*acl), GFP_KERNEL);
+	if (!acl)
+		return ERR_PTR(-ENOMEM);
+
+	acl->prio = cls->common.prio;
+	acl->meter = -1;
+	acl->counter = -1;
+
+	ret = rtl8365mb_acl_parse_match(flow, &match, extack);
+	if (ret)
+		goto err_free;
+
+	ret = rtl8365mb_acl_compile_match(acl, &match, BIT(port), extack);
+	if (ret)
+		goto err_free;
+
+	ret = rtl8365mb_acl_parse_action(ds, acl, flow, &police, extack);
+	if (ret)
+		goto err_free;
+
+	if (police) {
+		acl->police_index = police->hw_index;
+
+		shared = rtl8365mb_acl_police_find(mb, acl, true);
+		if (shared) {
+			ret = rtl8365mb_acl_port_join(priv, shared, port, extack);
+			if (ret)
+				goto err_free;
+
+			dev_dbg(priv->dev, "ACL entry %d extended to port %d\n",
+				shared->index, port);
+
+			kfree(acl);
+			return shared;
+		}
+	}
+
+	ret = rtl8365mb_acl_index_alloc(priv, acl->prio, extack);
+	if (ret < 0)
+		goto err_free;
+	acl->index = ret;
+
+	if (police) {
+		shared = rtl8365mb_acl_police_find(mb, acl, false);
+		if (shared) {
+			rtl8365mb_meter_hold(priv, shared->meter);
+			ret = shared->meter;
+		} else {
+			ret = rtl8365mb_meter_get(priv,
+						  police->police.rate_bytes_ps,
+						  police->police.burst, extack);
+			if (ret < 0)
+				goto err_free;
+		}
+
+		acl->meter = ret;
+		acl->act_ctrl |= RTL8365MB_ACL_ACTION_POLICING;
+		acl->act[1] |= FIELD_PREP(RTL8365MB_ACL_ACT_CONF1_METER_IDX_MASK,
+					  acl->meter);
+	} else {
+		/* The hits of the rule are counted as long as there are log
+		 * counters left, the rule is offloaded either way.
+		 */
+		ret = rtl8365mb_acl_counter_get(priv);
+		if (ret >= 0) {
+			acl->counter = ret;
+			acl->act_ctrl |= RTL8365MB_ACL_ACTION_LOGGING;
+			acl->act[1] |=
+				FIELD_PREP(RTL8365MB_ACL_ACT_CONF1_METER_IDX_MASK,
+					   acl->counter);
+		}
+	}
+
+	ret = rtl8365mb_acl_write(priv, acl);
+	if (ret) {
+		NL_SET_ERR_MSG_MOD(extack, "Failed to write ACL entry");
+		rtl8365mb_acl_clear(priv, acl->index);
+		goto err_put_meter;
+	}
+
+	mb->acl_rules[acl->index] = acl;
+
+	dev_dbg(priv->dev, "ACL entry %d with template %lu for port %d\n",
+		acl->index, FIELD_GET(RTL8365MB_ACL_RULE_CONF0_TYPE_MASK,
+				      acl->data[0]), port);
+
+	return acl;
+
+err_put_meter:
+	if (acl->meter >= 0)
+		rtl8365mb_meter_put(priv, acl->meter);
+	if (acl->counter >= 0)
+		rtl8365mb_acl_counter_put(priv, acl->counter);
+err_free:
+	kfree(acl);
+
+	return ERR_PTR(ret);
+}
+
+static void rtl8365mb_acl_rule_del(struct realtek_priv *priv,
+				   struct rtl8365mb_acl_rule *acl)
+{
+	struct rtl8365mb *mb = priv->chip_data;
+	int ret;
+
+	ret = rtl8365mb_acl_clear(priv, acl->index);
+	if (ret)
+		dev_err(priv->dev, "failed to clear ACL entry %d: %d\n",
+			acl->index, ret);
+
+	if (acl->meter >= 0)
+		rtl8365mb_meter_put(priv, acl->meter);
+
+	if (acl->counter >= 0)
+		rtl8365mb_acl_counter_put(priv, acl->counter);
+
+	mb->acl_rules[acl->index] = NULL;
+	kfree(acl);
+}
+
+static void rtl8365mb_acl_port_leave(struct realtek_priv *priv,
+				     struct rtl8365mb_acl_rule *acl, int port)
+{
+	int ret;
+
+	if (acl->pmask == BIT(port)) {
+		rtl8365mb_acl_rule_del(priv, acl);
+		return;
+	}
+
+	rtl8365mb_acl_set_pmask(acl, acl->pmask & ~BIT(port));
+	ret = rtl8365mb_acl_write(priv, acl);
+	if (ret)
+		dev_err(priv->dev, "failed to update ACL entry %d: %d\n",
+			acl->index, ret);
+}
+
+static int rtl8365mb_acl_setup(struct realtek_priv *priv)
+{
+	struct rtl8365mb *mb = priv->chip_data;
+	struct dsa_switch *ds = &priv->ds;
+	u16 val;
+	int ret;
+	int t;
+	int i;
+
+	mutex_init(&mb->acl_counter_lock);
+	memset(mb->acl_counters, 0, sizeof(mb->acl_counters));
+	INIT_DELAYED_WORK(&mb->acl_stats_work, rtl8365mb_acl_stats_poll);
+
+	for (t = 0; t < RTL8365MB_NUM_ACL_TEMPLATES; t++) {
+		for (i = 0; i < RTL8365MB_ACL_NUM_FIELDS; i += 2) {
+			const u8 *fields = rtl8365mb_acl_templates[t];
+
+			val = FIELD_PREP(RTL8365MB_ACL_TEMPLATE_CTRL_FIELD_EVEN_MASK,
+					 fields[i]) |
+			      FIELD_PREP(RTL8365MB_ACL_TEMPLATE_CTRL_FIELD_ODD_MASK,
+					 fields[i + 1]);
+			ret = regmap_write(priv->map,
+					   RTL8365MB_ACL_TEMPLATE_CTRL_REG(t, i),
+					   val);
+			if (ret)
+				return ret;
+		}
+	}
+
+	for (i = 0; i < RTL8365MB_ACL_NUM_FIELD_SELS; i++) {
+		val = FIELD_PREP(RTL8365MB_ACL_FIELD_SEL_FORMAT_MASK,
+				 rtl8365mb_acl_field_sels[i].format) |
+		      FIELD_PREP(RTL8365MB_ACL_FIELD_SEL_OFFSET_MASK,
+				 rtl8365mb_acl_field_sels[i].offset);
+		ret = regmap_write(priv->map, RTL8365MB_ACL_FIELD_SEL_REG(i),
+				   val);
+		if (ret)
+			return ret;
+	}
+
+	/* Start from an empty ACL */
+	for (i = 0; i < RTL8365MB_NUM_ACL_RULES; i++) {
+		ret = rtl8365mb_acl_clear(priv, i);
+		if (ret)
+			return ret;
+	}
+
+	/* Log counter pairs count packets and bytes */
+	ret = regmap_write(priv->map, RTL8365MB_MIB_LOG_TYPE_REG,
+			   RTL8365MB_MIB_LOG_TYPE_BYTES_MASK);
+	if (ret)
+		return ret;
+
+	/* Frames not matching any rule are forwarded normally */
+	ret = regmap_write(priv->map, RTL8365MB_ACL_UNMATCH_PERMIT_REG,
+			   RTL8365MB_ACL_PORTMASK_MASK);
+	if (ret)
+		return ret;
+
+	return regmap_write(priv->map, RTL8365MB_ACL_ENABLE_REG,
+			    dsa_user_ports(ds));
+}
+
+/* ICMPv6 types 133 to 137, router and neighbour solicitations and
+ * advertisements and redirects, as type and mask pairs
+ */
+static const u8 rtl8365mb_copp_ndisc_types[][2] = {
+	{ NDISC_ROUTER_SOLICITATION, 0xFF },
+	{ NDISC_ROUTER_ADVERTISEMENT, 0xFE },
+	{ NDISC_NEIGHBOUR_ADVERTISEMENT, 0xFE },
+};
+
+static const struct {
+	const char *name;
+	const char *stat;
+	unsigned int num_matches;
+} rtl8365mb_copp_classes[] = {
+	[RTL8365MB_COPP_ARP] = { "ARP", "coppArpExceedIntervals", 1 },
+	[RTL8365MB_COPP_IGMP] = { "IGMP", "coppIgmpExceedIntervals", 1 },
+	[RTL8365MB_COPP_NDISC] = { "neighbour discovery",
+				   "coppNdiscExceedIntervals",
+				   ARRAY_SIZE(rtl8365mb_copp_ndisc_types) },
+	[RTL8365MB_COPP_LINK_LOCAL] = { "link-local",
+					"coppLinkLocalExceedIntervals", 1 },
+};
+
+static int rtl8365mb_copp_match(enum rtl8365mb_copp copp, unsigned int n,
+				struct rtl8365mb_acl_match *m)
+{
+	/* 01:80:C2:00:00:0X - STP, LACP, 802.1X, LLDP and the like */
+	static const u8 link_local[ETH_ALEN] = { 0x01, 0x80, 0xC2 };
+	static const u8 link_local_mask[ETH_ALEN] = {
+		0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xF0
+	};
+
+	switch (copp) {
+	case RTL8365MB_COPP_ARP:
+		return rtl8365mb_acl_match_add(m, RTL8365MB_ACL_FIELD_ETHERTYPE,
+					       ETH_P_ARP, 0xFFFF, NULL);
+	case RTL8365MB_COPP_IGMP:
+		m->tags |= RTL8365MB_ACL_TAG_IPV4;
+		return rtl8365mb_acl_match_add(m,
+					       RTL8365MB_ACL_FIELD_SEL(RTL8365MB_ACL_SEL_IP4_PROTO),
+					       IPPROTO_IGMP, 0x00FF, NULL);
+	case RTL8365MB_COPP_NDISC:
+		/* The ICMPv6 type is the first byte of the IP payload */
+		m->tags |= RTL8365MB_ACL_TAG_IPV6;
+		return rtl8365mb_acl_match_add(m,
+					       RTL8365MB_ACL_FIELD_SEL(RTL8365MB_ACL_SEL_IP6_NEXTHDR),
+					       IPPROTO_ICMPV6 << 8, 0xFF00, NULL) ?:
+		       rtl8365mb_acl_match_add(m,
+					       RTL8365MB_ACL_FIELD_SEL(RTL8365MB_ACL_SEL_L4_SPORT),
+					       rtl8365mb_copp_ndisc_types[n][0] << 8,
+					       rtl8365mb_copp_ndisc_types[n][1] << 8,
+					       NULL);
+	case RTL8365MB_COPP_LINK_LOCAL:
+		return rtl8365mb_acl_match_mac(m, RTL8365MB_ACL_FIELD_DMAC0,
+					       link_local, link_local_mask,
+					       NULL);
+	default:
+		return -EINVAL;
+	}
+}
+
+static struct rtl8365mb_acl_rule *
+rtl8365mb_copp_rule_add(struct realtek_priv *priv, int port,
+			enum rtl8365mb_copp copp, unsigned int n, int meter)
+{
+	struct rtl8365mb *mb = priv->chip_data;
+	struct rtl8365mb_acl_match match = {};
+	struct rtl8365mb_acl_rule *acl;
+	int ret;
+
+	acl = kzalloc(sizeof(*acl), GFP_KERNEL);
+	if (!acl)
+		return ERR_PTR(-ENOMEM);
+
+	/* Looked up after every flower rule, which take precedence */
+	acl->prio = U32_MAX;
+	acl->counter = -1;
+
+	ret = rtl8365mb_copp_match(copp, n, &match);
+	if (ret)
+		goto err_free;
+
+	ret = rtl8365mb_acl_compile_match(acl, &match, BIT(port), NULL);
+	if (ret)
+		goto err_free;
+
+	ret = rtl8365mb_acl_index_alloc(priv, acl->prio, NULL);
+	if (ret < 0)
+		goto err_free;
+	acl->index = ret;
+
+	rtl8365mb_meter_hold(priv, meter);
+	acl->meter = meter;
+	acl->act_ctrl = RTL8365MB_ACL_ACTION_POLICING;
+	acl->act[1] = FIELD_PREP(RTL8365MB_ACL_ACT_CONF1_METER_IDX_MASK,
+				 acl->meter);
+
+	ret = rtl8365mb_acl_write(priv, acl);
+	if (ret) {
+		rtl8365mb_acl_clear(priv, acl->index);
+		goto err_put_meter;
+	}
+
+	mb->acl_rules[acl->index] = acl;
+
+	return acl;
+
+err_put_meter:
+	rtl8365mb_meter_put(priv, acl->meter);
+err_free:
+	kfree(acl);
+
+	return ERR_PTR(ret);
+}
+
+static void rtl8365mb_copp_rules_del(struct realtek_priv *priv,
+				     struct rtl8365mb_acl_rule **acls)
+{
+	int n;
+
+	for (n = 0; n < RTL8365MB_COPP_MAX_MATCHES; n++) {
+		if (acls[n])
+			rtl8365mb_acl_rule_del(priv, acls[n]);
+
+		acls[n] = NULL;
+	}
+}
+
+/* The rules of a class on a port share a meter of their own, so a flood on
+ * one port does not eat into the rate of the others. Returns the meter.
+ */
+static int rtl8365mb_copp_port_add(struct realtek_priv *priv, int port,
+				   enum rtl8365mb_copp copp, u32 kbps,
+				   struct rtl8365mb_acl_rule **acls)
+{
+	u64 rate = div_u64((u64)kbps * 1000, 8);
+	struct rtl8365mb_acl_rule *acl;
+	int meter;
+	int n;
+
+	meter = rtl8365mb_meter_get(priv, rate, rtl8365mb_meter_burst(rate),
+				    NULL);
+	if (meter < 0)
+		return meter;
+
+	for (n = 0; n < rtl8365mb_copp_classes[copp].num_matches; n++) {
+		acl = rtl8365mb_copp_rule_add(priv, port, copp, n, meter);
+		if (IS_ERR(acl)) {
+			rtl8365mb_copp_rules_del(priv, acls);
+			rtl8365mb_meter_put(priv, meter);
+			return PTR_ERR(acl);
+		}
+
+		acls[n] = acl;
+	}
+
+	/* The rules hold the meter from now on */
+	rtl8365mb_meter_put(priv, meter);
+
+	return meter;
+}
+
+/* Frames of a class are policed on ingress, whether they are trapped to the
+ * CPU port or forwarded to other ports. The new rules are installed before
+ * the old ones are removed, so the class is never left unpoliced while the
+ * rate changes.
+ */
+static int rtl8365mb_copp_set(struct realtek_priv *priv,
+			      enum rtl8365mb_copp copp, u32 kbps)
+{
+	struct rtl8365mb_acl_rule *acls[RTL8365MB_MAX_NUM_PORTS]
+				       [RTL8365MB_COPP_MAX_MATCHES] = {};
+	int meters[RTL8365MB_MAX_NUM_PORTS];
+	struct rtl8365mb *mb = priv->chip_data;
+	struct dsa_switch *ds = &priv->ds;
+	struct rtl8365mb_port *p;
+	struct dsa_port *dp;
+	int ret;
+
+	mutex_lock(&mb->acl_lock);
+
+	dsa_switch_for_each_user_port(dp, ds) {
+		meters[dp->index] = -1;
+
+		if (!kbps)
+			continue;
+
+		ret = rtl8365mb_copp_port_add(priv, dp->index, copp, kbps,
+					      acls[dp->index]);
+		if (ret < 0) {
+			dev_err(priv->dev,
+				"port %d: failed to add %s control plane protection rules: %d\n",
+				dp->index, rtl8365mb_copp_classes[copp].name,
+				ret);
+			goto err_del;
+		}
+
+		meters[dp->index] = ret;
+	}
+
+	dsa_switch_for_each_user_port(dp, ds) {
+		p = &mb->ports[dp->index];
+
+		WRITE_ONCE(p->copp_meter[copp], meters[dp->index]);
+		rtl8365mb_copp_rules_del(priv, p->copp_rules[copp]);
+		memcpy(p->copp_rules[copp], acls[dp->index],
+		       sizeof(p->copp_rules[copp]));
+	}
+
+	mb->copp_kbps[copp] = kbps;
+
+	mutex_unlock(&mb->acl_lock);
+
+	return 0;
+
+err_del:
+	dsa_switch_for_each_user_port(dp, ds)
+		rtl8365mb_copp_rules_del(priv, acls[dp->index]);
+
+	mutex_unlock(&mb->acl_lock);
+
+	return ret;
+}
+
+static void rtl8365mb_copp_init(struct realtek_priv *priv)
+{
+	struct rtl8365mb *mb = priv->chip_data;
+	int copp;
+	int i;
+
+	for (i = 0; i < RTL8365MB_MAX_NUM_PORTS; i++)
+		for (copp = 0; copp < RTL8365MB_COPP_END; copp++)
+			mb->ports[i].copp_meter[copp] = -1;
+
+	memset(mb->copp_kbps, 0, sizeof(mb->copp_kbps));
+}
+
+static void rtl8365mb_copp_teardown(struct realtek_priv *priv)
+{
+	struct rtl8365mb *mb = priv->chip_data;
+	struct dsa_switch *ds = &priv->ds;
+	struct rtl8365mb_port *p;
+	struct dsa_port *dp;
+	int copp;
+
+	mutex_lock(&mb->acl_lock);
+	dsa_switch_for_each_user_port(dp, ds) {
+		p = &mb->ports[dp->index];
+
+		for (copp = 0; copp < RTL8365MB_COPP_END; copp++) {
+			WRITE_ONCE(p->copp_meter[copp], -1);
+			rtl8365mb_copp_rules_del(priv, p->copp_rules[copp]);
+		}
+	}
+
+	memset(mb->copp_kbps, 0, sizeof(mb->copp_kbps));
+	mutex_unlock(&mb->acl_lock);
+}
+
+static int rtl8365mb_cls_flower_add(struct dsa_switch *ds, int port,
+				    struct flow_cls_offload *cls, bool ingress)
+{
+	struct netlink_ext_ack *extack = cls->common.extack;
+	struct realtek_priv *priv = ds->priv;
+	struct rtl8365mb *mb = priv->chip_data;
+	struct rtl8365mb_flower_rule *rule;
+	struct rtl8365mb_acl_rule *acl;
+	int ret;
+
+	if (!ingress) {
+		NL_SET_ERR_MSG_MOD(extack, "Only ingress rules are supported");
+		return -EOPNOTSUPP;
+	}
+
+	mutex_lock(&mb->acl_lock);
+
+	if (rtl8365mb_flower_rule_find(mb, port, cls->cookie)) {
+		ret = -EEXIST;
+		goto out_unlock;
+	}
+
+	rule = kzalloc(sizeof(*rule), GFP_KERNEL);
+	if (!rule) {
+		ret = -ENOMEM;
+		goto out_unlock;
+	}
+
+	acl = rtl8365mb_acl_rule_add(ds, port, cls);
+	if (IS_ERR(acl)) {
+		ret = PTR_ERR(acl);
+		goto err_free;
+	}
+
+	rule->cookie = cls->cookie;
+	rule->port = port;
+	rule->acl = acl;
+	list_add_tail(&rule->list, &mb->flower_rules);
+
+	mutex_unlock(&mb->acl_lock);
+
+	return 0;
+
+err_free:
+	kfree(rule);
+out_unlock:
+	mutex_unlock(&mb->acl_lock);
+
+	return ret;
+}
+
+static int rtl8365mb_cls_flower_del(struct dsa_switch *ds, int port,
+				    struct flow_cls_offload *cls, bool ingress)
+{
+	struct realtek_priv *priv = ds->priv;
+	struct rtl8365mb *mb = priv->chip_data;
+	struct rtl8365mb_flower_rule *rule;
+
+	mutex_lock(&mb->acl_lock);
+
+	rule = rtl8365mb_flower_rule_find(mb, port, cls->cookie);
+	if (!rule)
+		goto out_unlock;
+
+	rtl8365mb_acl_port_leave(priv, rule->acl, port);
+
+	list_del(&rule->list);
+	kfree(rule);
+
+out_unlock:
+	mutex_unlock(&mb->acl_lock);
+
+	return 0;
+}
+
+static int rtl8365mb_cls_flower_stats(struct dsa_switch *ds, int port,
+				      struct flow_cls_offload *cls,
+				      bool ingress)
+{
+	struct realtek_priv *priv = ds->priv;
+	struct rtl8365mb *mb = priv->chip_data;
+	struct rtl8365mb_flower_rule *rule;
+	struct rtl8365mb_acl_counter *c;
+	int ret = 0;
+
+	mutex_lock(&mb->acl_lock);
+
+	rule = rtl8365mb_flower_rule_find(mb, port, cls->cookie);
+	if (!rule) {
+		ret = -ENOENT;
+		goto out_unlock;
+	}
+
+	if (rule->acl->counter < 0)
+		goto out_unlock;
+
+	c = &mb->acl_counters[rule->acl->counter];
+
+	mutex_lock(&mb->acl_counter_lock);
+	flow_stats_update(&cls->stats, c->bytes - c->reported_bytes,
+			  c->packets - c->reported_packets, 0, c->lastused,
+			  FLOW_ACTION_HW_STATS_DELAYED);
+	c->reported_packets = c->packets;
+	c->reported_bytes = c->bytes;
+	mutex_unlock(&mb->acl_counter_lock);
+
+out_unlock:
+	mutex_unlock(&mb->acl_lock);
+
+	return ret;
+}
+
+/* Shared VLAN learning: the key is the MAC address and the FID */
+static void rtl8365mb_l2_key_encode(const u8 *mac, u16 fid, u16 *buf)
+{
+	memset(buf, 0, RTL8365MB_L2_ENTRY_SIZE * sizeof(*buf));
+
+	buf[0] = FIELD_PREP(RTL8365MB_L2_CONF0_MAC5_MASK, mac[5]) |
+		 FIELD_PREP(RTL8365MB_L2_CONF0_MAC4_MASK, mac[4]);
+	buf[1] = FIELD_PREP(RTL8365MB_L2_CONF1_MAC3_MASK, mac[3]) |
+		 FIELD_PREP(RTL8365MB_L2_CONF1_MAC2_MASK, mac[2]);
+	buf[2] = FIELD_PREP(RTL8365MB_L2_CONF2_MAC1_MASK, mac[1]) |
+		 FIELD_PREP(RTL8365MB_L2_CONF2_MAC0_MASK, mac[0]);
+	buf[3] = FIELD_PREP(RTL8365MB_L2_CONF3_VID_FID_MASK, fid);
+}
+
+static void rtl8365mb_l2_key_decode(const u16 *buf, u8 *mac, u16 *fid)
+{
+	mac[0] = FIELD_GET(RTL8365MB_L2_CONF2_MAC0_MASK, buf[2]);
+	mac[1] = FIELD_GET(RTL8365MB_L2_CONF2_MAC1_MASK, buf[2]);
+	mac[2] = FIELD_GET(RTL8365MB_L2_CONF1_MAC2_MASK, buf[1]);
+	mac[3] = FIELD_GET(RTL8365MB_L2_CONF1_MAC3_MASK, buf[1]);
+	mac[4] = FIELD_GET(RTL8365MB_L2_CONF0_MAC4_MASK, buf[0]);
+	mac[5] = FIELD_GET(RTL8365MB_L2_CONF0_MAC5_MASK, buf[0]);
+
+	*fid = FIELD_GET(RTL8365MB_L2_CONF3_VID_FID_MASK, buf[3]);
+}
+
+static void rtl8365mb_l2_uc_encode(const struct rtl8365mb_l2_uc *uc, u16 *buf)
+{
+	rtl8365mb_l2_key_encode(uc->mac, uc->fid, buf);
+
+	buf[3] |= FIELD_PREP(RTL8365MB_L2_UC_CONF3_SPA_MS_MASK,
+			     uc->port >> FIELD_WIDTH(RTL8365MB_L2_UC_CONF4_SPA_LS_MASK));
+	buf[4] = FIELD_PREP(RTL8365MB_L2_UC_CONF4_FID_MASK, uc->fid) |
+		 FIELD_PREP(RTL8365MB_L2_UC_CONF4_SPA_LS_MASK,
+			    uc->port & FIELD_MAX(RTL8365MB_L2_UC_CONF4_SPA_LS_MASK)) |
+		 FIELD_PREP(RTL8365MB_L2_UC_CONF4_AGE_MASK, uc->age);
+	buf[5] = FIELD_PREP(RTL8365MB_L2_UC_CONF5_NOSALEARN_MASK, uc->is_static);
+}
+
+static void rtl8365mb_l2_uc_decode(const u16 *buf, struct rtl8365mb_l2_uc *uc)
+{
+	rtl8365mb_l2_key_decode(buf, uc->mac, &uc->fid);
+
+	uc->port = FIELD_GET(RTL8365MB_L2_UC_CONF4_SPA_LS_MASK, buf[4]) |
+		   (FIELD_GET(RTL8365MB_L2_UC_CONF3_SPA_MS_MASK, buf[3]) <<
+		    FIELD_WIDTH(RTL8365MB_L2_UC_CONF4_SPA_LS_MASK));
+	uc->age = FIELD_GET(RTL8365MB_L2_UC_CONF4_AGE_MASK, buf[4]);
+	uc->is_static = FIELD_GET(RTL8365MB_L2_UC_CONF5_NOSALEARN_MASK, buf[5]);
+}
+
+/* Multicast entries forward to a port mask and are never aged out */
+static void rtl8365mb_l2_mc_encode(const u8 *mac, u16 fid, u16 member,
+				   u16 *buf)
+{
+	rtl8365mb_l2_key_encode(mac, fid, buf);
+
+	buf[3] |= FIELD_PREP(RTL8365MB_L2_MC_CONF3_MBR_MID_MASK,
+			     member >> FIELD_WIDTH(RTL8365MB_L2_MC_CONF4_MBR_LS_MASK));
+	buf[4] = FIELD_PREP(RTL8365MB_L2_MC_CONF4_MBR_LS_MASK,
+			    member & FIELD_MAX(RTL8365MB_L2_MC_CONF4_MBR_LS_MASK));
+	buf[5] = FIELD_PREP(RTL8365MB_L2_MC_CONF5_MBR_MS_MASK,
+			    member >> (FIELD_WIDTH(RTL8365MB_L2_MC_CONF4_MBR_LS_MASK) +
+				       FIELD_WIDTH(RTL8365MB_L2_MC_CONF3_MBR_MID_MASK)));
+
+	/* An entry without members is invalid and frees its slot */
+	if (member)
+		buf[5] |= RTL8365MB_L2_MC_CONF5_NOSALEARN_MASK;
+}
+
+/* Entries of the CAM are reported by index, they follow the hash table */
+static u32 rtl8365mb_l2_status_addr(u32 status)
+{
+	u32 addr = FIELD_GET(RTL8365MB_TABLE_LUT_ADDR_MASK, status);
+
+	if (status & RTL8365MB_TABLE_LUT_TYPE_MASK)
+		addr += RTL8365MB_L2_HASH_SIZE;
+
+	return addr;
+}
+
+/**
+ * rtl8365mb_l2_read() - run an L2 table read command
+ * @priv: realtek_priv pointer
+ * @method: lookup method
+ * @port: source port for RTL8365MB_L2_METHOD_NEXT_UC_SPA, ignored otherwise
+ * @addr: in: start address for address based methods, out: address of the
+ *        entry found
+ * @buf: in: key for RTL8365MB_L2_METHOD_MAC, out: entry found
+ *
+ * Return: 0 if an entry was found, -ENOENT if not, or another negative error
+ * code.
+ */
+static int rtl8365mb_l2_read(struct realtek_priv *priv,
+			     enum rtl8365mb_l2_method method, int port,
+			     u32 *addr, u16 *buf)
+{
+	struct rtl83xx_table_op op = {
+		.cmd = RTL8365MB_TABLE_CMD(RTL8365MB_TABLE_L2,
+					   RTL8365MB_TABLE_READ) |
+		       FIELD_PREP(RTL8365MB_TABLE_CONTROL_METHOD_MASK, method) |
+		       FIELD_PREP(RTL8365MB_TABLE_CONTROL_SPA_MASK, port),
+		.addr = RTL83XX_TABLE_NO_ADDR,
+		.rdata = buf,
+	};
+	u32 status;
+	int ret;
+
+	if (method == RTL8365MB_L2_METHOD_MAC)
+		op.wdata = buf;
+	else
+		op.addr = *addr;
+	op.status = &status;
+
+	ret = rtl83xx_table_exec(priv, &rtl8365mb_tables[RTL8365MB_TABLE_L2],
+				 &op, 1);
+	if (ret)
+		return ret;
+
+	if (!(status & RTL8365MB_TABLE_LUT_HIT_STATUS_MASK))
+		return -ENOENT;
+
+	*addr = rtl8365mb_l2_status_addr(status);
+
+	return 0;
+}
+
+/* The switch hashes the key of the written entry to find its place. The hit
+ * flag is cleared if neither the hash bucket nor the CAM had room for it.
+ */
+static int rtl8365mb_l2_write(struct realtek_priv *priv, const u16 *buf,
+			      u32 *addr)
+{
+	struct rtl83xx_table_op op = {
+		.cmd = RTL8365MB_TABLE_CMD(RTL8365MB_TABLE_L2,
+					   RTL8365MB_TABLE_WRITE),
+		.addr = RTL83XX_TABLE_NO_ADDR,
+		.wdata = buf,
+	};
+	u32 status;
+	int ret;
+
+	op.status = &status;
+
+	ret = rtl83xx_table_exec(priv, &rtl8365mb_tables[RTL8365MB_TABLE_L2],
+				 &op, 1);
+	if (ret)
+		return ret;
+
+	if (!(status & RTL8365MB_TABLE_LUT_HIT_STATUS_MASK))
+		return -ENOSPC;
+
+	if (addr)
+		*addr = rtl8365mb_l2_status_addr(status);
+
+	return 0;
+}
+
+static u32 rtl8365mb_l2_index_key(const u8 *mac, u16 fid)
+{
+	return jhash(mac, ETH_ALEN, fid);
+}
+
+static struct rtl8365mb_l2_index_entry *
+rtl8365mb_l2_index_find(struct rtl8365mb *mb, const u8 *mac, u16 fid)
+{
+	struct rtl8365mb_l2_index_entry *e;
+
+	hash_for_each_possible(mb->l2_index, e, node,
+			       rtl8365mb_l2_index_key(mac, fid))
+		if (e->fid == fid && ether_addr_equal(e->mac, mac))
+			return e;
+
+	return NULL;
+}
+
+static bool rtl8365mb_l2_index_has_vid(struct rtl8365mb_l2_index_entry *e,
+				       u16 vid)
+{
+	unsigned int i;
+
+	for (i = 0; i < e->num_vids; i++)
+		if (e->vids[i] == vid)
+			return true;
+
+	return false;
+}
+
+static int rtl8365mb_l2_index_add_vid(struct rtl8365mb_l2_index_entry *e,
+				      u16 vid)
+{
+	u16 *vids;
+
+	vids = krealloc_array(e->vids, e->num_vids + 1, sizeof(*vids),
+			      GFP_KERNEL);
+	if (!vids)
+		return -ENOMEM;
+
+	vids[e->num_vids++] = vid;
+	e->vids = vids;
+
+	return 0;
+}
+
+static void rtl8365mb_l2_index_del_vid(struct rtl8365mb_l2_index_entry *e,
+				       u16 vid)
+{
+	unsigned int i;
+
+	for (i = 0; i < e->num_vids; i++) {
+		if (e->vids[i] == vid) {
+			e->vids[i] = e->vids[--e->num_vids];
+			return;
+		}
+	}
+}
+
+static void rtl8365mb_l2_index_free(struct rtl8365mb_l2_index_entry *e)
+{
+	hash_del(&e->node);
+	kfree(e->vids);
+	kfree(e);
+}
+
+static void rtl8365mb_l2_index_flush(struct rtl8365mb *mb)
+{
+	struct rtl8365mb_l2_index_entry *e;
+	struct hlist_node *tmp;
+	int bkt;
+
+	mutex_lock(&mb->l2_lock);
+	hash_for_each_safe(mb->l2_index, bkt, tmp, e, node)
+		rtl8365mb_l2_index_free(e);
+	mutex_unlock(&mb->l2_lock);
+}
+
+static int rtl8365mb_db_to_fid(struct realtek_priv *priv,
+			       const struct dsa_db *db, u16 *fid)
+{
+	struct rtl8365mb *mb = priv->chip_data;
+
+	switch (db->type) {
+	case DSA_DB_PORT:
+		*fid = mb->ports[db->dp->index].fid;
+		return 0;
+	case DSA_DB_BRIDGE:
+		*fid = mb->bridge_fid[db->bridge.num];
+		return 0;
+	default:
+		return -EOPNOTSUPP;
+	}
+}
+
+static int rtl8365mb_port_fdb_add(struct dsa_switch *ds, int port,
+				  const unsigned char *addr, u16 vid,
+				  struct dsa_db db)
+{
+	struct realtek_priv *priv = ds->priv;
+	struct rtl8365mb *mb = priv->chip_data;
+	struct rtl8365mb_l2_index_entry *e;
+	u16 buf[RTL8365MB_L2_ENTRY_SIZE];
+	struct rtl8365mb_l2_uc uc = {
+		.port = port,
+		.age = FIELD_MAX(RTL8365MB_L2_UC_CONF4_AGE_MASK),
+		.is_static = true,
+	};
+	bool new = false;
+	int ret;
+
+	ret = rtl8365mb_db_to_fid(priv, &db, &uc.fid);
+	if (ret)
+		return ret;
+
+	ether_addr_copy(uc.mac, addr);
+
+	dev_dbg(priv->dev, "add FDB entry %pM vid %u fid %u on port %d\n",
+		addr, vid, uc.fid, port);
+
+	mutex_lock(&mb->l2_lock);
+
+	/* The address is already installed, for this or another VLAN of the
+	 * bridge
+	 */
+	e = rtl8365mb_l2_index_find(mb, addr, uc.fid);
+	if (e && e->port == port) {
+		if (!rtl8365mb_l2_index_has_vid(e, vid))
+			ret = rtl8365mb_l2_index_add_vid(e, vid);
+		goto out;
+	}
+
+	if (!e) {
+		e = kzalloc(sizeof(*e), GFP_KERNEL);
+		if (!e) {
+			ret = -ENOMEM;
+			goto out;
+		}
+
+		ret = rtl8365mb_l2_index_add_vid(e, vid);
+		if (ret) {
+			kfree(e);
+			goto out;
+		}
+		new = true;
+	}
+
+	rtl8365mb_l2_uc_encode(&uc, buf);
+	ret = rtl8365mb_l2_write(priv, buf, &e->addr);
+	if (ret) {
+		if (ret == -ENOSPC)
+			dev_err(priv->dev,
+				"no room in L2 table for %pM fid %u\n", addr,
+				uc.fid);
+		if (new) {
+			kfree(e->vids);
+			kfree(e);
+		}
+		goto out;
+	}
+
+	if (e->addr >= RTL8365MB_L2_HASH_SIZE)
+		dev_dbg(priv->dev, "%pM fid %u spilled over to CAM entry %u\n",
+			addr, uc.fid, e->addr - RTL8365MB_L2_HASH_SIZE);
+
+	/* An address moving to another port takes the entry over, the FDB
+	 * entries of the old port no longer map to it. The VLAN set of an
+	 * installed entry is never empty, so there is room for the VID.
+	 */
+	if (!new && e->port != port) {
+		e->vids[0] = vid;
+		e->num_vids = 1;
+	}
+
+	e->port = port;
+	if (new) {
+		ether_addr_copy(e->mac, addr);
+		e->fid = uc.fid;
+		hash_add(mb->l2_index, &e->node,
+			 rtl8365mb_l2_index_key(addr, uc.fid));
+	}
+
+out:
+	mutex_unlock(&mb->l2_lock);
+
+	return ret;
+}
+
+static int rtl8365mb_port_fdb_del(struct dsa_switch *ds, int port,
+				  const unsigned char *addr, u16 vid,
+				  struct dsa_db db)
+{
+	struct realtek_priv *priv = ds->priv;
+	struct rtl8365mb *mb = priv->chip_data;
+	struct rtl8365mb_l2_index_entry *e;
+	u16 buf[RTL8365MB_L2_ENTRY_SIZE];
+	struct rtl8365mb_l2_uc uc = {};
+	int ret;
+
+	ret = rtl8365mb_db_to_fid(priv, &db, &uc.fid);
+	if (ret)
+		return ret;
+
+	dev_dbg(priv->dev, "del FDB entry %pM vid %u fid %u on port %d\n",
+		addr, vid, uc.fid, port);
+
+	mutex_lock(&mb->l2_lock);
+
+	/* The address may have moved to another port in the meantime */
+	e = rtl8365mb_l2_index_find(mb, addr, uc.fid);
+	if (!e || e->port != port || !rtl8365mb_l2_index_has_vid(e, vid))
+		goto out;
+
+	rtl8365mb_l2_index_del_vid(e, vid);
+	if (e->num_vids)
+		goto out;
+
+	/* Rewriting the key with age zero invalidates the entry where the
+	 * switch placed it, so no lookup is needed beforehand
+	 */
+	ether_addr_copy(uc.mac, addr);
+	uc.port = e->port;
+	rtl8365mb_l2_uc_encode(&uc, buf);
+	ret = rtl8365mb_l2_write(priv, buf, NULL);
+
+	/* The hit flag is not set when an entry is removed */
+	if (ret == -ENOSPC)
+		ret = 0;
+
+	rtl8365mb_l2_index_free(e);
+
+out:
+	mutex_unlock(&mb->l2_lock);
+
+	return ret;
+}
+
+static struct rtl8365mb_l2_mc_group *
+rtl8365mb_l2_mc_find(struct rtl8365mb *mb, const u8 *mac, u16 fid)
+{
+	struct rtl8365mb_l2_mc_group *g;
+
+	hash_for_each_possible(mb->l2_mc, g, node,
+			       rtl8365mb_l2_index_key(mac, fid))
+		if (g->fid == fid && ether_addr_equal(g->mac, mac))
+			return g;
+
+	return NULL;
+}
+
+static u16 rtl8365mb_l2_mc_member(const struct rtl8365mb_l2_mc_group *g)
+{
+	u16 member = 0;
+	int i;
+
+	for (i = 0; i < RTL8365MB_MAX_NUM_PORTS; i++)
+		if (g->refcount[i])
+			member |= BIT(i);
+
+	return member;
+}
+
+static int rtl8365mb_l2_mc_write(struct realtek_priv *priv,
+				 const struct rtl8365mb_l2_mc_group *g)
+{
+	u16 member = rtl8365mb_l2_mc_member(g);
+	u16 buf[RTL8365MB_L2_ENTRY_SIZE];
+	int ret;
+
+	rtl8365mb_l2_mc_encode(g->mac, g->fid, member, buf);
+	ret = rtl8365mb_l2_write(priv, buf, NULL);
+
+	/* The hit flag is not set when an entry is removed */
+	if (ret == -ENOSPC && !member)
+		ret = 0;
+
+	return ret;
+}
+
+static int rtl8365mb_port_mdb_add(struct dsa_switch *ds, int port,
+				  const struct switchdev_obj_port_mdb *mdb,
+				  struct dsa_db db)
+{
+	struct realtek_priv *priv = ds->priv;
+	struct rtl8365mb *mb = priv->chip_data;
+	struct rtl8365mb_l2_mc_group *g;
+	bool new = false;
+	u16 fid;
+	int ret;
+
+	ret = rtl8365mb_db_to_fid(priv, &db, &fid);
+	if (ret)
+		return ret;
+
+	dev_dbg(priv->dev, "add MDB entry %pM vid %u fid %u on port %d\n",
+		mdb->addr, mdb->vid, fid, port);
+
+	mutex_lock(&mb->l2_lock);
+
+	g = rtl8365mb_l2_mc_find(mb, mdb->addr, fid);
+	if (!g) {
+		g = kzalloc(sizeof(*g), GFP_KERNEL);
+		if (!g) {
+			ret = -ENOMEM;
+			goto out;
+		}
+
+		ether_addr_copy(g->mac, mdb->addr);
+		g->fid = fid;
+		new = true;
+	}
+
+	/* Only a new member changes the entry */
+	if (g->refcount[port]++)
+		goto out;
+
+	ret = rtl8365mb_l2_mc_write(priv, g);
+	if (ret) {
+		if (ret == -ENOSPC)
+			dev_err(priv->dev, "no room in L2 table for %pM fid %u\n",
+				mdb->addr, fid);
+		g->refcount[port]--;
+		if (new)
+			kfree(g);
+		goto out;
+	}
+
+	if (new)
+		hash_add(mb->l2_mc, &g->node,
+			 rtl8365mb_l2_index_key(g->mac, g->fid));
+
+out:
+	mutex_unlock(&mb->l2_lock);
+
+	return ret;
+}
+
+static int rtl8365mb_port_mdb_del(struct dsa_switch *ds, int port,
+				  const struct switchdev_obj_port_mdb *mdb,
+				  struct dsa_db db)
+{
+	struct realtek_priv *priv = ds->priv;
+	struct rtl8365mb *mb = priv->chip_data;
+	struct rtl8365mb_l2_mc_group *g;
+	u16 fid;
+	int ret;
+
+	ret = rtl8365mb_db_to_fid(priv, &db, &fid);
+	if (ret)
+		return ret;
+
+	dev_dbg(priv->dev, "del MDB entry %pM vid %u fid %u on port %d\n",
+		mdb->addr, mdb->vid, fid, port);
+
+	mutex_lock(&mb->l2_lock);
+
+	g = rtl8365mb_l2_mc_find(mb, mdb->addr, fid);
+	if (!g || !g->refcount[port] || --g->refcount[port])
+		goto out;
+
+	ret = rtl8365mb_l2_mc_write(priv, g);
+	if (ret) {
+		g->refcount[port]++;
+		goto out;
+	}
+
+	if (!rtl8365mb_l2_mc_member(g)) {
+		hash_del(&g->node);
+		kfree(g);
+	}
+
+out:
+	mutex_unlock(&mb->l2_lock);
+
+	return ret;
+}
+
+static int rtl8365mb_mdb_setup(struct realtek_priv *priv)
+{
+	struct dsa_switch *ds = &priv->ds;
+	struct dsa_port *dp;
+	u32 val;
+	int ret;
+
+	/* Forward IP multicast by the group MAC address, which is what the
+	 * bridge installs
+	 */
+	ret = regmap_update_bits(priv->map, RTL8365MB_LUT_CFG_REG,
+				 RTL8365MB_LUT_CFG_IPMC_L3_LOOKUP_MASK, 0);
+	if (ret)
+		return ret;
+
+	/* Membership reports are sent to the group address itself, so they
+	 * would only reach the ports of the offloaded group. Have the switch
+	 * flood reports and queries in the VLAN instead, which includes the
+	 * CPU port. Trapping them is not an option: the tagger marks every
+	 * frame as already forwarded, so the bridge would never forward them
+	 * in software either.
+	 */
+	val = FIELD_PREP(RTL8365MB_IGMP_PORT_CTRL_IGMPV1_OP_MASK,
+			 RTL8365MB_IGMP_OP_FLOOD) |
+	      FIELD_PREP(RTL8365MB_IGMP_PORT_CTRL_IGMPV2_OP_MASK,
+			 RTL8365MB_IGMP_OP_FLOOD) |
+	      FIELD_PREP(RTL8365MB_IGMP_PORT_CTRL_IGMPV3_OP_MASK,
+			 RTL8365MB_IGMP_OP_FLOOD) |
+	      FIELD_PREP(RTL8365MB_IGMP_PORT_CTRL_MLDV1_OP_MASK,
+			 RTL8365MB_IGMP_OP_FLOOD) |
+	      FIELD_PREP(RTL8365MB_IGMP_PORT_CTRL_MLDV2_OP_MASK,
+			 RTL8365MB_IGMP_OP_FLOOD);
+
+	dsa_switch_for_each_user_port(dp, ds) {
+		ret = regmap_write(priv->map,
+				   RTL8365MB_IGMP_PORT_CTRL_REG(dp->index), val);
+		if (ret)
+			return ret;
+	}
+
+	return 0;
+}
+
+static void rtl8365mb_mdb_teardown(struct rtl8365mb *mb)
+{
+	struct rtl8365mb_l2_mc_group *g;
+	struct hlist_node *tmp;
+	int bkt;
+
+	mutex_lock(&mb->l2_lock);
+	hash_for_each_safe(mb->l2_mc, bkt, tmp, g, node) {
+		hash_del(&g->node);
+		kfree(g);
+	}
+	mutex_unlock(&mb->l2_lock);
+}
+
+static int rtl8365mb_port_fdb_dump(struct dsa_switch *ds, int port,
+				   dsa_fdb_dump_cb_t *cb, void *data)
+{
+	struct realtek_priv *priv = ds->priv;
+	struct rtl8365mb *mb = priv->chip_data;
+	u16 buf[RTL8365MB_L2_ENTRY_SIZE];
+	struct rtl8365mb_l2_uc uc;
+	u32 start = 0;
+	u32 addr;
+	int ret;
+
+	mutex_lock(&mb->l2_lock);
+
+	while (start < RTL8365MB_L2_SIZE) {
+		addr = start;
+		ret = rtl8365mb_l2_read(priv, RTL8365MB_L2_METHOD_NEXT_UC_SPA,
+					port, &addr, buf);
+		if (ret == -ENOENT) {
+			ret = 0;
+			break;
+		}
+		if (ret)
+			break;
+
+		/* The search wraps around at the end of the table */
+		if (addr < start)
+			break;
+
+		rtl8365mb_l2_uc_decode(buf, &uc);
+
+		/* Entries are keyed by FID, the VLAN is not known */
+		ret = cb(uc.mac, 0, uc.is_static, data);
+		if (ret)
+			break;
+
+		start = addr + 1;
+	}
+
+	mutex_unlock(&mb->l2_lock);
+
+	return ret;
+}
+
+/**
+ * rtl8365mb_l2_flush() - flush dynamic L2 entries with the flush engine
+ * @priv: realtek_priv pointer
+ * @ports: mask of the ports whose learned entries are flushed
+ * @mode: restrict the flush to entries of a VID or FID
+ * @vid_fid: VID or FID for the respective mode, ignored otherwise
+ *
+ * Static entries are kept. The engine walks the whole table in hardware,
+ * which takes a few milliseconds instead of the ageing time.
+ *
+ * Return: 0 on success, negative value for failure.
+ */
+static int rtl8365mb_l2_flush(struct realtek_priv *priv, u32 ports,
+			      enum rtl8365mb_l2_flush_mode mode, u16 vid_fid)
+{
+	struct rtl8365mb *mb = priv->chip_data;
+	ktime_t start;
+	u32 val;
+	int ret;
+
+	mutex_lock(&mb->l2_lock);
+
+	if (mode == RTL8365MB_L2_FLUSH_MODE_PORT_VID) {
+		ret = regmap_write(priv->map, RTL8365MB_L2_FLUSH_CTRL1_REG,
+				   FIELD_PREP(RTL8365MB_L2_FLUSH_CTRL1_VID_MASK,
+					      vid_fid));
+		if (ret)
+			goto out;
+	}
+
+	val = FIELD_PREP(RTL8365MB_L2_FLUSH_CTRL2_MODE_MASK, mode);
+	if (mode == RTL8365MB_L2_FLUSH_MODE_PORT_FID)
+		val |= FIELD_PREP(RTL8365MB_L2_FLUSH_CTRL2_FID_MASK, vid_fid);
+	ret = regmap_write(priv->map, RTL8365MB_L2_FLUSH_CTRL2_REG, val);
+	if (ret)
+		goto out;
+
+	start = ktime_get();
+
+	ret = regmap_write(priv->map, RTL8365MB_L2_FORCE_FLUSH_REG,
+			   FIELD_PREP(RTL8365MB_L2_FORCE_FLUSH_PORTMASK_MASK,
+				      ports));
+	if (ret)
+		goto out;
+
+	ret = regmap_read_poll_timeout(priv->map, RTL8365MB_L2_FORCE_FLUSH_REG,
+				       val, !(val & ports), 50,
+				       RTL8365MB_L2_FLUSH_TIMEOUT_US);
+	if (ret) {
+		dev_err(priv->dev, "timeout flushing L2 entries of ports 0x%x\n",
+			ports);
+		goto out;
+	}
+
+	dev_dbg(priv->dev, "flushed L2 entries of ports 0x%x (mode %d, %u) in %lld us\n",
+		ports, mode, vid_fid, ktime_us_delta(ktime_get(), start));
+
+out:
+	mutex_unlock(&mb->l2_lock);
+
+	return ret;
+}
+
+/* Queue a notification for the bridge, sent by rtl8365mb_l2_notify_flush()
+ * once the scan has dropped l2_lock. The caller must hold l2_lock.
+ */
+static void rtl8365mb_l2_notify(struct realtek_priv *priv, unsigned long type,
+				int port, const u8 *mac)
+{
+	struct rtl8365mb *mb = priv->chip_data;
+	struct rtl8365mb_l2_event *ev;
+
+	ev = kzalloc(sizeof(*ev), GFP_KERNEL);
+	if (!ev)
+		return;
+
+	ev->type = type;
+	ev->port = port;
+	ether_addr_copy(ev->mac, mac);
+	list_add_tail(&ev->list, &mb->l2_events);
+}
+
+/* Send the queued notifications. The notifiers need RTNL, but teardown may
+ * wait for the scan work while holding it, so give up if RTNL is taken.
+ */
+static bool rtl8365mb_l2_notify_flush(struct realtek_priv *priv)
+{
+	struct rtl8365mb *mb = priv->chip_data;
+	struct rtl8365mb_l2_event *ev, *tmp;
+	LIST_HEAD(events);
+
+	if (!rtnl_trylock())
+		return false;
+
+	mutex_lock(&mb->l2_lock);
+	list_splice_init(&mb->l2_events, &events);
+	mutex_unlock(&mb->l2_lock);
+
+	list_for_each_entry_safe(ev, tmp, &events, list) {
+		struct dsa_port *dp = dsa_to_port(&priv->ds, ev->port);
+		struct switchdev_notifier_fdb_info info = {
+			.addr = ev->mac,
+			/* Only ports of VLAN-unaware bridges are scanned */
+			.vid = 0,
+			.offloaded = true,
+		};
+
+		if (dp->user)
+			call_switchdev_notifiers(ev->type, dp->user, &info.info,
+						 NULL);
+
+		list_del(&ev->list);
+		kfree(ev);
+	}
+
+	rtnl_unlock();
+
+	return true;
+}
+
+/* Record an entry found by the scan, and tell the bridge about new or moved
+ * addresses. Return the number of notifications sent.
+ */
+static unsigned int rtl8365mb_l2_scan_seen(struct realtek_priv *priv,
+					   const struct rtl8365mb_l2_uc *uc)
+{
+	struct rtl8365mb *mb = priv->chip_data;
+	struct rtl8365mb_l2_learned *l;
+	unsigned int notified = 0;
+
+	hash_for_each_possible(mb->l2_learned, l, node,
+			       rtl8365mb_l2_index_key(uc->mac, uc->fid)) {
+		if (l->fid != uc->fid || !ether_addr_equal(l->mac, uc->mac))
+			continue;
+
+		l->gen = mb->l2_scan_gen;
+		if (l->port == uc->port)
+			return 0;
+
+		rtl8365mb_l2_notify(priv, SWITCHDEV_FDB_DEL_TO_BRIDGE, l->port,
+				    l->mac);
+		l->port = uc->port;
+		rtl8365mb_l2_notify(priv, SWITCHDEV_FDB_ADD_TO_BRIDGE, l->port,
+				    l->mac);
+		return 2;
+	}
+
+	l = kzalloc(sizeof(*l), GFP_KERNEL);
+	if (!l)
+		return 0;
+
+	ether_addr_copy(l->mac, uc->mac);
+	l->fid = uc->fid;
+	l->port = uc->port;
+	l->gen = mb->l2_scan_gen;
+	hash_add(mb->l2_learned, &l->node,
+		 rtl8365mb_l2_index_key(l->mac, l->fid));
+
+	rtl8365mb_l2_notify(priv, SWITCHDEV_FDB_ADD_TO_BRIDGE, l->port, l->mac);
+	notified++;
+
+	return notified;
+}
+
+/* A full pass is over: whatever was not seen during it has aged out */
+static void rtl8365mb_l2_scan_done(struct realtek_priv *priv)
+{
+	struct rtl8365mb *mb = priv->chip_data;
+	struct rtl8365mb_l2_learned *l;
+	struct hlist_node *tmp;
+	int bkt;
+
+	hash_for_each_safe(mb->l2_learned, bkt, tmp, l, node) {
+		if (l->gen == mb->l2_scan_gen)
+			continue;
+
+		rtl8365mb_l2_notify(priv, SWITCHDEV_FDB_DEL_TO_BRIDGE, l->port,
+				    l->mac);
+		hash_del(&l->node);
+		kfree(l);
+	}
+
+	mb->l2_scan_gen++;
+	mb->l2_scan_cursor = 0;
+}
+
+/* Entries are keyed by FID, which is shared by all VLANs of a bridge, so the
+ * VLAN an address was learned in is not known. Addresses are only reported
+ * for VLAN-unaware bridges, where VLAN 0 is the right one.
+ */
+static bool rtl8365mb_l2_scan_port(struct realtek_priv *priv, int port)
+{
+	struct dsa_switch *ds = &priv->ds;
+	struct dsa_port *dp;
+
+	if (port >= ds->num_ports || !dsa_is_user_port(ds, port))
+		return false;
+
+	dp = dsa_to_port(ds, port);
+
+	return dsa_port_bridge_dev_get(dp) && !dsa_port_is_vlan_filtering(dp);
+}
+
+/**
+ * rtl8365mb_l2_scan_work() - report hardware learned addresses to the bridge
+ * @work: work_struct of rtl8365mb::l2_scan_work
+ *
+ * The L2 table is walked incrementally from a cursor with the "next unicast
+ * entry" search, which skips empty slots in hardware, so each run costs at
+ * most RTL8365MB_L2_SCAN_BUDGET table commands regardless of the table size.
+ * A run also stops after RTL8365MB_L2_SCAN_NOTIFY_BUDGET notifications, which
+ * bounds the bridge updates sent while the table churns. Entries that were
+ * not seen during a full pass have aged out and are removed from the bridge.
+ *
+ * The table is only scanned under l2_lock. RTNL is taken afterwards, just to
+ * send the notifications found.
+ */
+static void rtl8365mb_l2_scan_work(struct work_struct *work)
+{
+	struct rtl8365mb *mb = container_of(to_delayed_work(work),
+					    struct rtl8365mb, l2_scan_work);
+	struct realtek_priv *priv = mb->priv;
+	unsigned int budget = RTL8365MB_L2_SCAN_BUDGET;
+	u16 buf[RTL8365MB_L2_ENTRY_SIZE];
+	unsigned int notified = 0;
+	struct rtl8365mb_l2_uc uc;
+	u32 addr;
+	int ret;
+
+	mutex_lock(&mb->l2_lock);
+
+	/* Scan once the notifications of the previous run are out */
+	if (!list_empty(&mb->l2_events))
+		budget = 0;
+
+	while (budget-- && notified < RTL8365MB_L2_SCAN_NOTIFY_BUDGET) {
+		addr = mb->l2_scan_cursor;
+		ret = rtl8365mb_l2_read(priv, RTL8365MB_L2_METHOD_NEXT_UC, 0,
+					&addr, buf);
+		if (ret && ret != -ENOENT) {
+			dev_err_ratelimited(priv->dev,
+					    "failed to scan L2 table: %d\n", ret);
+			break;
+		}
+
+		/* Nothing left, or the search wrapped around */
+		if (ret == -ENOENT || addr < mb->l2_scan_cursor) {
+			rtl8365mb_l2_scan_done(priv);
+			break;
+		}
+
+		mb->l2_scan_cursor = addr + 1;
+
+		rtl8365mb_l2_uc_decode(buf, &uc);
+		if (!uc.is_static && rtl8365mb_l2_scan_port(priv, uc.port))
+			notified += rtl8365mb_l2_scan_seen(priv, &uc);
+
+		if (mb->l2_scan_cursor >= RTL8365MB_L2_SIZE) {
+			rtl8365mb_l2_scan_done(priv);
+			break;
+		}
+	}
+
+	mutex_unlock(&mb->l2_lock);
+
+	if (!rtl8365mb_l2_notify_flush(priv)) {
+		schedule_delayed_work(&mb->l2_scan_work, HZ / 10);
+		return;
+	}
+
+	schedule_delayed_work(&mb->l2_scan_work,
+			      RTL8365MB_L2_SCAN_INTERVAL_JIFFIES);
+}
+
+static void rtl8365mb_l2_scan_setup(struct realtek_priv *priv)
+{
+	struct rtl8365mb *mb = priv->chip_data;
+
+	hash_init(mb->l2_learned);
+	INIT_LIST_HEAD(&mb->l2_events);
+	mb->l2_scan_cursor = 0;
+	mb->l2_scan_gen = 0;
+
+	INIT_DELAYED_WORK(&mb->l2_scan_work, rtl8365mb_l2_scan_work);
+	schedule_delayed_work(&mb->l2_scan_work,
+			      RTL8365MB_L2_SCAN_INTERVAL_JIFFIES);
+}
+
+static void rtl8365mb_l2_scan_teardown(struct realtek_priv *priv)
+{
+	struct rtl8365mb *mb = priv->chip_data;
+	struct rtl8365mb_l2_event *ev, *ev_tmp;
+	struct rtl8365mb_l2_learned *l;
+	struct hlist_node *tmp;
+	int bkt;
+
+	cancel_delayed_work_sync(&mb->l2_scan_work);
+
+	hash_for_each_safe(mb->l2_learned, bkt, tmp, l, node) {
+		hash_del(&l->node);
+		kfree(l);
+	}
+
+	list_for_each_entry_safe(ev, ev_tmp, &mb->l2_events, list) {
+		list_del(&ev->list);
+		kfree(ev);
+	}
+}
+
+/**
+ * struct rtl8365mb_ageing - L2 ageing timer setting
+ * @secs: resulting ageing time in seconds
+ * @speed: unit of the ageing timer
+ * @timer: ageing timer, in units selected by @speed
+ */
+struct rtl8365mb_ageing {
+	unsigned int secs;
+	u8 speed;
+	u8 timer;
+};
+
+/* Ageing timer settings, as listed by the vendor driver. The timer counts in
+ * units of about 44 seconds at speed 0 and of about 229 seconds at speed 1.
+ */
+static const struct rtl8365mb_ageing rtl8365mb_ageing_times[] = {
+	{ .secs = 45, .speed = 0, .timer = 1 },
+	{ .secs = 88, .speed = 0, .timer = 2 },
+	{ .secs = 133, .speed = 0, .timer = 3 },
+	{ .secs = 177, .speed = 0, .timer = 4 },
+	{ .secs = 221, .speed = 0, .timer = 5 },
+	{ .secs = 266, .speed = 0, .timer = 6 },
+	{ .secs = 310, .speed = 0, .timer = 7 },
+	{ .secs = 458, .speed = 1, .timer = 2 },
+	{ .secs = 687, .speed = 1, .timer = 3 },
+	{ .secs = 916, .speed = 1, .timer = 4 },
+};
+
+/* Picks the shortest setting that is not below @msecs, so that entries never
+ * age out earlier than requested
+ */
+static const struct rtl8365mb_ageing *
+rtl8365mb_ageing_lookup(unsigned int msecs)
+{
+	unsigned int secs = DIV_ROUND_UP(msecs, MSEC_PER_SEC);
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(rtl8365mb_ageing_times) - 1; i++)
+		if (rtl8365mb_ageing_times[i].secs >= secs)
+			break;
+
+	return &rtl8365mb_ageing_times[i];
+}
+
+static int rtl8365mb_set_ageing_time(struct dsa_switch *ds, unsigned int msecs)
+{
+	const struct rtl8365mb_ageing *ageing = rtl8365mb_ageing_lookup(msecs);
+	struct realtek_priv *priv = ds->priv;
+
+	dev_dbg(priv->dev, "ageing time %u ms set to %u s\n", msecs,
+		ageing->secs);
+
+	return regmap_update_bits(priv->map, RTL8365MB_LUT_CFG_REG,
+				  RTL8365MB_LUT_CFG_AGE_TIMER_MASK |
+				  RTL8365MB_LUT_CFG_AGE_SPEED_MASK,
+				  FIELD_PREP(RTL8365MB_LUT_CFG_AGE_TIMER_MASK,
+					     ageing->timer) |
+				  FIELD_PREP(RTL8365MB_LUT_CFG_AGE_SPEED_MASK,
+					     ageing->speed));
+}
+
+static void rtl8365mb_port_fast_age(struct dsa_switch *ds, int port)
+{
+	struct realtek_priv *priv = ds->priv;
+	int ret;
+
+	ret = rtl8365mb_l2_flush(priv, BIT(port), RTL8365MB_L2_FLUSH_MODE_PORT,
+				 0);
+	if (ret)
+		dev_err(priv->dev, "failed to fast age port %d: %d\n", port,
+			ret);
+}
+
+static const struct rtl8365mb_extint *
+rtl8365mb_get_port_extint(struct realtek_priv *priv, int port)
+{
+	struct rtl8365mb *mb = priv->chip_data;
+	int i;
+
+	for (i = 0; i < RTL8365MB_MAX_NUM_EXTINTS; i++) {
+		const struct rtl8365mb_extint *extint =
+			&mb->chip_info->extints[i];
+
+		if (!extint->supported_interfaces)
+			continue;
+
+		if (extint->port == port)
+			return extint;
+	}
+
+	return NULL;
+}
+
+static enum dsa_tag_protocol
+rtl8365mb_get_tag_protocol(struct dsa_switch *ds, int port,
+			   enum dsa_tag_protocol mp)
+{
+	struct realtek_priv *priv = ds->priv;
+	struct rtl8365mb_cpu *cpu;
+	struct rtl8365mb *mb;
+
+	mb = priv->chip_data;
+	cpu = &mb->cpu;
+
+	if (cpu->position == RTL8365MB_CPU_POS_BEFORE_CRC)
+		return DSA_TAG_PROTO_RTL8_4T;
+
+	return DSA_TAG_PROTO_RTL8_4;
+}
+
+static int rtl8365mb_ext_config_rgmii(struct realtek_priv *priv, int port,
+				      phy_interface_t interface)
+{
+	const struct rtl8365mb_extint *extint =
+		rtl8365mb_get_port_extint(priv, port);
+	struct dsa_switch *ds = &priv->ds;
+	struct device_node *dn;
+	struct dsa_port *dp;
+	int tx_delay = 0;
+	int rx_delay = 0;
 	u32 val;
 	int ret;
 
@@ -1770,6 +6199,201 @@ static int rtl8365mb_port_max_mtu(struct dsa_switch *ds, int port)
 	return RTL8365MB_CFG0_MAX_LEN_MAX - VLAN_ETH_HLEN - ETH_FCS_LEN;
 }
 
+static int rtl8365mb_fid_alloc(struct rtl8365mb *mb)
+{
+	unsigned long fid;
+
+	fid = find_next_zero_bit(mb->fid_map, RTL8365MB_NUM_FIDS,
+				 RTL8365MB_FID_DEFAULT + 1);
+	if (fid >= RTL8365MB_NUM_FIDS)
+		return -ENOSPC;
+
+	__set_bit(fid, mb->fid_map);
+
+	return fid;
+}
+
+static void rtl8365mb_fid_free(struct rtl8365mb *mb, int fid)
+{
+	if (fid != RTL8365MB_FID_DEFAULT)
+		__clear_bit(fid, mb->fid_map);
+}
+
+/* Free @fid once no port is left in it. A port failing to switch FIDs stays
+ * in its old one, which must not be handed out again until it moves on.
+ */
+static void rtl8365mb_fid_put(struct realtek_priv *priv, int fid)
+{
+	struct rtl8365mb *mb = priv->chip_data;
+	int i;
+
+	for (i = 0; i < priv->num_ports; i++)
+		if (mb->ports[i].fid == fid)
+			return;
+
+	rtl8365mb_fid_free(mb, fid);
+}
+
+static int rtl8365mb_port_set_fid(struct realtek_priv *priv, int port, int fid)
+{
+	struct rtl8365mb *mb = priv->chip_data;
+	int ret;
+
+	ret = regmap_write(priv->map, RTL8365MB_PORT_PBFID_REG(port),
+			   FIELD_PREP(RTL8365MB_PORT_PBFID_MASK, fid));
+	if (ret)
+		return ret;
+
+	mb->ports[port].fid = fid;
+
+	return 0;
+}
+
+/* Each bridge gets its own FID, shared by all of its ports, so that the same
+ * address can be learned independently in two bridges. Every user port owns a
+ * FID while standalone and gives it back when joining a bridge. As a bridge has
+ * at least one port, there are never more FIDs in use than user ports.
+ */
+static int rtl8365mb_port_bridge_fid_join(struct realtek_priv *priv, int port,
+					  struct dsa_bridge bridge,
+					  struct netlink_ext_ack *extack)
+{
+	struct rtl8365mb *mb = priv->chip_data;
+	int old_fid = mb->ports[port].fid;
+	bool new_fid = false;
+	int fid;
+	int ret;
+
+	fid = mb->bridge_fid[bridge.num];
+	if (!fid) {
+		fid = rtl8365mb_fid_alloc(mb);
+		if (fid < 0) {
+			NL_SET_ERR_MSG_MOD(extack, "No free FID for the bridge");
+			return fid;
+		}
+
+		mb->bridge_fid[bridge.num] = fid;
+		new_fid = true;
+	}
+
+	ret = rtl8365mb_port_set_fid(priv, port, fid);
+	if (ret) {
+		if (new_fid) {
+			mb->bridge_fid[bridge.num] = 0;
+			rtl8365mb_fid_free(mb, fid);
+		}
+		return ret;
+	}
+
+	/* Addresses learned while standalone must not linger in a FID which
+	 * may later be handed out to another port
+	 */
+	rtl8365mb_l2_flush(priv, BIT(port), RTL8365MB_L2_FLUSH_MODE_PORT_FID,
+			   old_fid);
+	rtl8365mb_fid_put(priv, old_fid);
+
+	dev_dbg(priv->dev, "port %d joined bridge %u with FID %d\n", port,
+		bridge.num, fid);
+
+	return 0;
+}
+
+static void rtl8365mb_port_bridge_fid_leave(struct realtek_priv *priv,
+					    int port, struct dsa_bridge bridge,
+					    bool last)
+{
+	struct rtl8365mb *mb = priv->chip_data;
+	int fid;
+	int ret;
+
+	fid = rtl8365mb_fid_alloc(mb);
+	if (fid < 0) {
+		dev_err(priv->dev, "no free FID for standalone port %d\n", port);
+		fid = RTL8365MB_FID_DEFAULT;
+	}
+
+	ret = rtl8365mb_port_set_fid(priv, port, fid);
+	if (ret) {
+		dev_err(priv->dev, "failed to set FID of port %d: %d\n", port,
+			ret);
+		rtl8365mb_fid_free(mb, fid);
+	}
+
+	rtl8365mb_l2_flush(priv, BIT(port), RTL8365MB_L2_FLUSH_MODE_PORT_FID,
+			   mb->bridge_fid[bridge.num]);
+
+	if (last) {
+		rtl8365mb_fid_put(priv, mb->bridge_fid[bridge.num]);
+		mb->bridge_fid[bridge.num] = 0;
+	}
+}
+
+static int rtl8365mb_port_set_isolation(struct realtek_priv *priv, int port,
+					u32 mask)
+{
+	return regmap_write(priv->map, RTL8365MB_PORT_ISOLATION_REG(port), mask);
+}
+
+/* Build the isolation matrix of the current topology: CPU ports reach all user
+ * ports, user ports reach the CPU ports and the other ports of their bridge.
+ * Isolated ports only reach the non-isolated ports of their bridge. Unused
+ * ports keep their committed mask.
+ */
+static void rtl8365mb_port_isolation_build(struct realtek_priv *priv, u32 *iso)
+{
+	struct rtl8365mb *mb = priv->chip_data;
+	struct dsa_switch *ds = &priv->ds;
+	struct dsa_port *other;
+	struct dsa_port *dp;
+
+	memcpy(iso, mb->isolation, sizeof(mb->isolation));
+
+	dsa_switch_for_each_available_port(dp, ds) {
+		if (dsa_port_is_cpu(dp)) {
+			iso[dp->index] = dsa_user_ports(ds);
+			continue;
+		}
+
+		iso[dp->index] = mb->cpu.mask;
+
+		dsa_switch_for_each_available_port(other, ds) {
+			if (other == dp || !dsa_port_bridge_same(dp, other))
+				continue;
+
+			if (mb->isolated & BIT(dp->index) &&
+			    mb->isolated & BIT(other->index))
+				continue;
+
+			iso[dp->index] |= BIT(other->index);
+		}
+	}
+}
+
+static int rtl8365mb_port_isolation_apply(struct realtek_priv *priv)
+{
+	struct rtl8365mb *mb = priv->chip_data;
+	u32 iso[RTL8365MB_MAX_NUM_PORTS];
+
+	rtl8365mb_port_isolation_build(priv, iso);
+
+	return rtl83xx_port_isolation_commit(priv, mb->isolation, iso,
+					     rtl8365mb_port_set_isolation);
+}
+
+/* Other ports of this switch offloading @bridge */
+static u32 rtl8365mb_bridge_peers(struct dsa_switch *ds, int port,
+				  const struct dsa_bridge *bridge)
+{
+	struct dsa_port *dp;
+	u32 mask = 0;
+
+	dsa_switch_for_each_available_port(dp, ds)
+		if (dp->index != port && dsa_port_offloads_bridge(dp, bridge))
+			mask |= BIT(dp->index);
+
+	return mask;
+}
+
 static int
 rtl8365mb_port_bridge_join(struct dsa_switch *ds, int port,
 			   struct dsa_bridge bridge,
@@ -1777,33 +6401,22 @@ rtl8365mb_port_bridge_join(struct dsa_switch *ds, int port,
 			   struct netlink_ext_ack *extack)
 {
 	struct realtek_priv *priv = ds->priv;
-	unsigned int port_bitmap = 0;
-	struct dsa_port *dp;
 	int ret;
 
-	dsa_switch_for_each_available_port(dp, ds) {
-		/* Current port handled last */
-		if (port == dp->index)
-			continue;
-
-		/* Not on this bridge */
-		if (!dsa_port_offloads_bridge(dp, &bridge))
-			continue;
-
-		/* Join this port to each other port on the bridge */
-		ret = regmap_update_bits(priv->map,
-					 RTL8365MB_PORT_ISOLATION_REG(dp->index),
-					 BIT(port), BIT(port));
-		if (ret)
-			dev_err(priv->dev, "failed to join port %d\n", port);
+	ret = rtl8365mb_port_bridge_fid_join(priv, port, bridge, extack);
+	if (ret)
+		return ret;
 
-		port_bitmap |= BIT(dp->index);
+	ret = rtl8365mb_port_isolation_apply(priv);
+	if (ret) {
+		NL_SET_ERR_MSG_MOD(extack, "Failed to update port isolation");
+		rtl8365mb_port_bridge_fid_leave(priv, port, bridge,
+						!rtl8365mb_bridge_peers(ds, port,
+									&bridge));
+		return ret;
 	}
 
-	/* Set the bits for the ports we can access */
-	return port_bitmap ? regmap_update_bits(priv->map,
-				  RTL8365MB_PORT_ISOLATION_REG(port),
-				  port_bitmap, port_bitmap) : 0;
+	return 0;
 }
 
 static void
@@ -1811,33 +6424,20 @@ rtl8365mb_port_bridge_leave(struct dsa_switch *ds, int port,
 			    struct dsa_bridge bridge)
 {
 	struct realtek_priv *priv = ds->priv;
-	unsigned int port_bitmap = 0;
-	struct dsa_port *dp;
-	int ret;
-
-	dsa_switch_for_each_available_port(dp, ds) {
-		/* Current port handled last */
-		if (port == dp->index)
-			continue;
-
-		/* Not on this bridge */
-		if (!dsa_port_offloads_bridge(dp, &bridge))
-			continue;
+	struct rtl8365mb *mb = priv->chip_data;
 
-		/* Remove this port from any other port on the bridge */
-		ret = regmap_update_bits(priv->map,
-					 RTL8365MB_PORT_ISOLATION_REG(dp->index),
-					 BIT(port), 0);
-		if (ret)
-			dev_err(priv->dev, "failed to leave port %d\n", port);
+	/* BR_ISOLATED is not cleared by DSA on leave, and must not carry over
+	 * to the next bridge
+	 */
+	mb->isolated &= ~BIT(port);
 
-		port_bitmap |= BIT(dp->index);
-	}
+	/* The port is already unbridged, so the new matrix isolates it from
+	 * its former bridge peers. A failure leaves the old matrix in place.
+	 */
+	rtl8365mb_port_isolation_apply(priv);
 
-	/* Clear the bits for the ports we can not access, leave ourselves */
-	regmap_update_bits(priv->map,
-			   RTL8365MB_PORT_ISOLATION_REG(port),
-			   port_bitmap, 0);
+	rtl8365mb_port_bridge_fid_leave(priv, port, bridge,
+					!rtl8365mb_bridge_peers(ds, port, &bridge));
 }
 
 static void rtl8365mb_port_stp_state_set(struct dsa_switch *ds, int port,
@@ -1866,21 +6466,256 @@ static void rtl8365mb_port_stp_state_set(struct dsa_switch *ds, int port,
 		return;
 	}
 
-	regmap_update_bits(priv->map, RTL8365MB_MSTI_CTRL_REG(msti, port),
-			   RTL8365MB_MSTI_CTRL_PORT_STATE_MASK(port),
-			   val << RTL8365MB_MSTI_CTRL_PORT_STATE_OFFSET(port));
+	regmap_update_bits(priv->map, RTL8365MB_MSTI_CTRL_REG(msti, port),
+			   RTL8365MB_MSTI_CTRL_PORT_STATE_MASK(port),
+			   val << RTL8365MB_MSTI_CTRL_PORT_STATE_OFFSET(port));
+}
+
+/* Enable/disable learning by limiting the number of L2 addresses the port
+ * can learn. Realtek documentation states that a limit of zero disables
+ * learning. When enabling learning, set it to the configured limit, the
+ * chip's maximum by default.
+ *
+ * A port at its limit applies the overflow action to every frame with an
+ * unknown source address, so a zero limit is only usable with the forward
+ * action. Otherwise keep learning at the configured limit: a standalone port
+ * learns in its private FID, where this is harmless.
+ */
+static u16 rtl8365mb_port_learn_limit(struct rtl8365mb *mb, int port)
+{
+	if (!mb->ports[port].learning &&
+	    mb->learn_over_act == RTL8365MB_LEARN_OVER_ACT_FORWARD)
+		return 0;
+
+	return mb->learn_limit;
+}
+
+static int rtl8365mb_port_set_learning(struct realtek_priv *priv, int port,
+				       bool enable)
+{
+	struct rtl8365mb *mb = priv->chip_data;
+	bool old = mb->ports[port].learning;
+	int ret;
+
+	mb->ports[port].learning = enable;
+
+	ret = regmap_write(priv->map, RTL8365MB_LUT_PORT_LEARN_LIMIT_REG(port),
+			   rtl8365mb_port_learn_limit(mb, port));
+	if (ret)
+		mb->ports[port].learning = old;
+
+	return ret;
+}
+
+static const char * const rtl8365mb_learn_over_act_names[] = {
+	[RTL8365MB_LEARN_OVER_ACT_FORWARD] = "forward",
+	[RTL8365MB_LEARN_OVER_ACT_DROP] = "drop",
+	[RTL8365MB_LEARN_OVER_ACT_TRAP] = "trap",
+};
+
+/* Limit the number of addresses each port may learn so that a single port
+ * cannot exhaust the L2 table shared by all ports. Ports start at the chip's
+ * maximum and forward frames from further source addresses without learning
+ * them, both can be changed through devlink.
+ */
+static int rtl8365mb_learn_limit_setup(struct realtek_priv *priv)
+{
+	struct rtl8365mb *mb = priv->chip_data;
+
+	mb->learn_limit = RTL8365MB_LEARN_LIMIT_MAX;
+	mb->learn_over_act = RTL8365MB_LEARN_OVER_ACT_FORWARD;
+
+	return regmap_update_bits(priv->map, RTL8365MB_PORT_SECURITY_CTRL_REG,
+				  RTL8365MB_PORT_SECURITY_CTRL_LEARN_OVER_ACT_MASK,
+				  FIELD_PREP(RTL8365MB_PORT_SECURITY_CTRL_LEARN_OVER_ACT_MASK,
+					     mb->learn_over_act));
+}
+
+static int rtl8365mb_learn_limits_write(struct realtek_priv *priv)
+{
+	struct rtl8365mb *mb = priv->chip_data;
+	struct dsa_switch *ds = &priv->ds;
+	struct dsa_port *dp;
+	int ret;
+
+	dsa_switch_for_each_available_port(dp, ds) {
+		ret = regmap_write(priv->map,
+				   RTL8365MB_LUT_PORT_LEARN_LIMIT_REG(dp->index),
+				   rtl8365mb_port_learn_limit(mb, dp->index));
+		if (ret)
+			return ret;
+	}
+
+	return 0;
+}
+
+static int rtl8365mb_learn_limit_set(struct realtek_priv *priv, u32 limit)
+{
+	struct rtl8365mb *mb = priv->chip_data;
+	u16 old = mb->learn_limit;
+	int ret;
+
+	if (limit > RTL8365MB_LEARN_LIMIT_MAX) {
+		dev_err(priv->dev, "learning limit %u exceeds maximum %u\n",
+			limit, RTL8365MB_LEARN_LIMIT_MAX);
+		return -EINVAL;
+	}
+
+	rtnl_lock();
+
+	mb->learn_limit = limit;
+	ret = rtl8365mb_learn_limits_write(priv);
+	if (ret) {
+		mb->learn_limit = old;
+		rtl8365mb_learn_limits_write(priv);
+	}
+
+	rtnl_unlock();
+
+	return ret;
+}
+
+static int rtl8365mb_learn_over_act_set(struct realtek_priv *priv,
+					const char *name)
+{
+	struct rtl8365mb *mb = priv->chip_data;
+	struct dsa_switch *ds = &priv->ds;
+	enum rtl8365mb_learn_over_act old;
+	struct dsa_port *dp;
+	int act;
+	int ret;
+
+	act = match_string(rtl8365mb_learn_over_act_names,
+			   ARRAY_SIZE(rtl8365mb_learn_over_act_names), name);
+	if (act < 0) {
+		dev_err(priv->dev, "invalid learning overflow action %s\n",
+			name);
+		return act;
+	}
+
+	rtnl_lock();
+
+	/* See rtl8365mb_port_learn_limit */
+	if (act != RTL8365MB_LEARN_OVER_ACT_FORWARD) {
+		dsa_switch_for_each_user_port(dp, ds) {
+			if (mb->ports[dp->index].learning ||
+			    !dsa_port_bridge_dev_get(dp))
+				continue;
+
+			dev_err(priv->dev,
+				"port %d must have learning enabled for learning overflow action %s\n",
+				dp->index, name);
+			ret = -EBUSY;
+			goto out_unlock;
+		}
+	}
+
+	/* Ports not learning have no limit while the action is forward. The
+	 * limits are only set to zero once forwarding is in effect, and lifted
+	 * before any other action is.
+	 */
+	old = mb->learn_over_act;
+	mb->learn_over_act = act;
+
+	if (act != RTL8365MB_LEARN_OVER_ACT_FORWARD) {
+		ret = rtl8365mb_learn_limits_write(priv);
+		if (ret)
+			goto err_restore;
+	}
+
+	ret = regmap_update_bits(priv->map, RTL8365MB_PORT_SECURITY_CTRL_REG,
+				 RTL8365MB_PORT_SECURITY_CTRL_LEARN_OVER_ACT_MASK,
+				 FIELD_PREP(RTL8365MB_PORT_SECURITY_CTRL_LEARN_OVER_ACT_MASK,
+					    act));
+	if (ret)
+		goto err_restore;
+
+	if (act == RTL8365MB_LEARN_OVER_ACT_FORWARD)
+		ret = rtl8365mb_learn_limits_write(priv);
+
+	goto out_unlock;
+
+err_restore:
+	mb->learn_over_act = old;
+	rtl8365mb_learn_limits_write(priv);
+out_unlock:
+	rtnl_unlock();
+
+	return ret;
+}
+
+static int rtl8365mb_port_set_flood(struct realtek_priv *priv, u32 reg,
+				    int port, bool enable)
+{
+	return regmap_update_bits(priv->map, reg, BIT(port),
+				  enable ? BIT(port) : 0);
+}
+
+/* The CPU port only receives flooded unknown unicast and multicast when a
+ * user port needs the host to see such frames, e.g. when it is promiscuous
+ */
+static int rtl8365mb_host_flood_sync(struct realtek_priv *priv)
+{
+	struct rtl8365mb *mb = priv->chip_data;
+	u16 cpu_mask = mb->cpu.mask;
+	int ret;
+
+	ret = regmap_update_bits(priv->map, RTL8365MB_UNKNOWN_UC_FLOOD_PMSK_REG,
+				 cpu_mask, mb->host_flood_uc ? cpu_mask : 0);
+	if (ret)
+		return ret;
+
+	return regmap_update_bits(priv->map, RTL8365MB_UNKNOWN_MC_FLOOD_PMSK_REG,
+				  cpu_mask, mb->host_flood_mc ? cpu_mask : 0);
 }
 
-static int rtl8365mb_port_set_learning(struct realtek_priv *priv, int port,
-				       bool enable)
+static void rtl8365mb_port_set_host_flood(struct dsa_switch *ds, int port,
+					  bool uc, bool mc)
+{
+	struct realtek_priv *priv = ds->priv;
+	struct rtl8365mb *mb = priv->chip_data;
+	int ret;
+
+	if (uc)
+		mb->host_flood_uc |= BIT(port);
+	else
+		mb->host_flood_uc &= ~BIT(port);
+
+	if (mc)
+		mb->host_flood_mc |= BIT(port);
+	else
+		mb->host_flood_mc &= ~BIT(port);
+
+	ret = rtl8365mb_host_flood_sync(priv);
+	if (ret)
+		dev_err(priv->dev, "failed to set host flooding for port %d: %d\n",
+			port, ret);
+}
+
+static int rtl8365mb_flood_setup(struct realtek_priv *priv)
 {
-	/* Enable/disable learning by limiting the number of L2 addresses the
-	 * port can learn. Realtek documentation states that a limit of zero
-	 * disables learning. When enabling learning, set it to the chip's
-	 * maximum.
+	struct rtl8365mb *mb = priv->chip_data;
+	u32 user_ports = dsa_user_ports(&priv->ds);
+	int ret;
+
+	/* User ports start with flooding enabled, like new bridge ports. The
+	 * host only asks for unknown addresses when it needs them.
 	 */
-	return regmap_write(priv->map, RTL8365MB_LUT_PORT_LEARN_LIMIT_REG(port),
-			    enable ? RTL8365MB_LEARN_LIMIT_MAX : 0);
+	mb->host_flood_uc = 0;
+	mb->host_flood_mc = 0;
+
+	ret = regmap_write(priv->map, RTL8365MB_UNKNOWN_UC_FLOOD_PMSK_REG,
+			   user_ports);
+	if (ret)
+		return ret;
+
+	ret = regmap_write(priv->map, RTL8365MB_UNKNOWN_MC_FLOOD_PMSK_REG,
+			   user_ports);
+	if (ret)
+		return ret;
+
+	return regmap_write(priv->map, RTL8365MB_BC_FLOOD_PMSK_REG,
+			    user_ports | mb->cpu.mask);
 }
 
 static int
@@ -1888,10 +6723,22 @@ rtl8365mb_port_pre_bridge_flags(struct dsa_switch *ds, int port,
 				struct switchdev_brport_flags flags,
 				struct netlink_ext_ack *extack)
 {
-	/* We support enabling/disabling learning */
-	if (flags.mask & ~(BR_LEARNING))
+	struct realtek_priv *priv = ds->priv;
+	struct rtl8365mb *mb = priv->chip_data;
+
+	/* We support enabling/disabling learning, flooding and port isolation */
+	if (flags.mask & ~(BR_LEARNING | BR_FLOOD | BR_MCAST_FLOOD |
+			   BR_BCAST_FLOOD | BR_ISOLATED))
 		return -EINVAL;
 
+	/* See rtl8365mb_port_set_learning */
+	if ((flags.mask & BR_LEARNING) && !(flags.val & BR_LEARNING) &&
+	    mb->learn_over_act != RTL8365MB_LEARN_OVER_ACT_FORWARD) {
+		NL_SET_ERR_MSG_MOD(extack,
+				   "Learning cannot be disabled unless the learning overflow action is forward");
+		return -EOPNOTSUPP;
+	}
+
 	return 0;
 }
 
@@ -1900,17 +6747,56 @@ rtl8365mb_port_bridge_flags(struct dsa_switch *ds, int port,
 			    struct switchdev_brport_flags flags,
 			    struct netlink_ext_ack *extack)
 {
-	if (flags.mask & BR_LEARNING)
-		return rtl8365mb_port_set_learning(ds->priv, port,
-						   !!(flags.val & BR_LEARNING));
+	struct realtek_priv *priv = ds->priv;
+	int ret;
 
-	return 0;
-}
+	if (flags.mask & BR_LEARNING) {
+		ret = rtl8365mb_port_set_learning(priv, port,
+						  !!(flags.val & BR_LEARNING));
+		if (ret)
+			return ret;
+	}
 
-static int rtl8365mb_port_set_isolation(struct realtek_priv *priv, int port,
-					u32 mask)
-{
-	return regmap_write(priv->map, RTL8365MB_PORT_ISOLATION_REG(port), mask);
+	if (flags.mask & BR_FLOOD) {
+		ret = rtl8365mb_port_set_flood(priv,
+					       RTL8365MB_UNKNOWN_UC_FLOOD_PMSK_REG,
+					       port, !!(flags.val & BR_FLOOD));
+		if (ret)
+			return ret;
+	}
+
+	if (flags.mask & BR_MCAST_FLOOD) {
+		ret = rtl8365mb_port_set_flood(priv,
+					       RTL8365MB_UNKNOWN_MC_FLOOD_PMSK_REG,
+					       port, !!(flags.val & BR_MCAST_FLOOD));
+		if (ret)
+			return ret;
+	}
+
+	if (flags.mask & BR_BCAST_FLOOD) {
+		ret = rtl8365mb_port_set_flood(priv, RTL8365MB_BC_FLOOD_PMSK_REG,
+					       port, !!(flags.val & BR_BCAST_FLOOD));
+		if (ret)
+			return ret;
+	}
+
+	if (flags.mask & BR_ISOLATED) {
+		struct rtl8365mb *mb = priv->chip_data;
+		u32 isolated = mb->isolated;
+
+		if (flags.val & BR_ISOLATED)
+			mb->isolated |= BIT(port);
+		else
+			mb->isolated &= ~BIT(port);
+
+		ret = rtl8365mb_port_isolation_apply(priv);
+		if (ret) {
+			mb->isolated = isolated;
+			return ret;
+		}
+	}
+
+	return 0;
 }
 
 static int rtl8365mb_mib_counter_read(struct realtek_priv *priv, int port,
@@ -1970,11 +6856,22 @@ static int rtl8365mb_mib_counter_read(struct realtek_priv *priv, int port,
 static void rtl8365mb_get_ethtool_stats(struct dsa_switch *ds, int port, u64 *data)
 {
 	struct realtek_priv *priv = ds->priv;
+	struct rtl8365mb_port *p;
 	struct rtl8365mb *mb;
 	int ret;
 	int i;
 
 	mb = priv->chip_data;
+	p = &mb->ports[port];
+
+	/* Driver counters follow the MIB counters */
+	spin_lock(&p->stats_lock);
+	data[RTL8365MB_MIB_END] = p->learn_over;
+	data[RTL8365MB_MIB_END + 1] = p->storm_exceed;
+	if (dsa_is_user_port(ds, port))
+		for (i = 0; i < RTL8365MB_COPP_END; i++)
+			data[RTL8365MB_MIB_END + 2 + i] = p->copp_exceed[i];
+	spin_unlock(&p->stats_lock);
 
 	mutex_lock(&mb->mib_lock);
 	for (i = 0; i < RTL8365MB_MIB_END; i++) {
@@ -2003,6 +6900,13 @@ static void rtl8365mb_get_strings(struct dsa_switch *ds, int port, u32 stringset
 		struct rtl8365mb_mib_counter *mib = &rtl8365mb_mib_counters[i];
 		ethtool_puts(&data, mib->name);
 	}
+
+	ethtool_puts(&data, "learnOverflowEvents");
+	ethtool_puts(&data, "stormExceedEvents");
+
+	if (dsa_is_user_port(ds, port))
+		for (i = 0; i < RTL8365MB_COPP_END; i++)
+			ethtool_puts(&data, rtl8365mb_copp_classes[i].stat);
 }
 
 static int rtl8365mb_get_sset_count(struct dsa_switch *ds, int port, int sset)
@@ -2010,7 +6914,10 @@ static int rtl8365mb_get_sset_count(struct dsa_switch *ds, int port, int sset)
 	if (sset != ETH_SS_STATS)
 		return -EOPNOTSUPP;
 
-	return RTL8365MB_MIB_END;
+	if (dsa_is_user_port(ds, port))
+		return RTL8365MB_MIB_END + 2 + RTL8365MB_COPP_END;
+
+	return RTL8365MB_MIB_END + 2;
 }
 
 static void rtl8365mb_get_phy_stats(struct dsa_switch *ds, int port,
@@ -2291,10 +7198,117 @@ static int rtl8365mb_get_and_clear_status_reg(struct realtek_priv *priv, u32 reg
 	return regmap_write(priv->map, reg, *val);
 }
 
+static int rtl8365mb_learn_over_handle(struct realtek_priv *priv)
+{
+	struct rtl8365mb *mb = priv->chip_data;
+	unsigned long learn_over;
+	u32 val;
+	int port;
+	int ret;
+
+	ret = rtl8365mb_get_and_clear_status_reg(
+		priv, RTL8365MB_PORT_LEARN_OVER_IND_REG, &val);
+	if (ret)
+		return ret;
+
+	learn_over = FIELD_GET(RTL8365MB_PORT_LEARN_OVER_IND_MASK, val);
+
+	for_each_set_bit(port, &learn_over, priv->num_ports) {
+		struct rtl8365mb_port *p = &mb->ports[port];
+
+		/* A zero limit only means that learning is disabled */
+		if (!rtl8365mb_port_learn_limit(mb, port))
+			continue;
+
+		spin_lock(&p->stats_lock);
+		p->learn_over++;
+		spin_unlock(&p->stats_lock);
+
+		dev_notice_ratelimited(priv->dev,
+				       "port %d reached its learning limit of %u addresses, %s frames from new addresses\n",
+				       port, mb->learn_limit,
+				       rtl8365mb_learn_over_act_names[mb->learn_over_act]);
+	}
+
+	return 0;
+}
+
+static int rtl8365mb_meter_exceed_handle(struct realtek_priv *priv)
+{
+	u32 exceed[RTL8365MB_NUM_METERS / 16];
+	struct rtl8365mb *mb = priv->chip_data;
+	struct dsa_switch *ds = &priv->ds;
+	struct dsa_port *dp;
+	int storm;
+	int copp;
+	int ret;
+	int i;
+
+	/* The meters of flower policers are cleared along the way */
+	for (i = 0; i < ARRAY_SIZE(exceed); i++) {
+		ret = rtl8365mb_get_and_clear_status_reg(
+			priv, RTL8365MB_METER_EXCEED_REG(i * 16), &exceed[i]);
+		if (ret)
+			return ret;
+	}
+
+	dsa_switch_for_each_user_port(dp, ds) {
+		struct rtl8365mb_port *p = &mb->ports[dp->index];
+
+		for (storm = 0; storm < RTL8365MB_STORM_END; storm++) {
+			int meter = READ_ONCE(p->storm_meter[storm]);
+
+			if (meter < 0 ||
+			    !(exceed[meter >> 4] & RTL8365MB_METER_EXCEED_MASK(meter)))
+				continue;
+
+			spin_lock(&p->stats_lock);
+			p->storm_exceed++;
+			spin_unlock(&p->stats_lock);
+
+			dev_notice_ratelimited(priv->dev,
+					       "port %d: %s storm above %u Kbps, dropping excess frames\n",
+					       dp->index,
+					       rtl8365mb_storm_names[storm],
+					       mb->storm_kbps[storm]);
+		}
+
+		for (copp = 0; copp < RTL8365MB_COPP_END; copp++) {
+			int meter = READ_ONCE(p->copp_meter[copp]);
+
+			if (meter < 0 ||
+			    !(exceed[meter >> 4] & RTL8365MB_METER_EXCEED_MASK(meter)))
+				continue;
+
+			spin_lock(&p->stats_lock);
+			p->copp_exceed[copp]++;
+			spin_unlock(&p->stats_lock);
+
+			dev_notice_ratelimited(priv->dev,
+					       "port %d: %s above %u Kbps, dropping excess frames\n",
+					       dp->index,
+					       rtl8365mb_copp_classes[copp].name,
+					       mb->copp_kbps[copp]);
+		}
+	}
+
+	ret = regmap_update_bits(priv->map, RTL8365MB_INTR_CTRL_REG,
+				 RTL8365MB_INTR_METER_EXCEEDED_MASK, 0);
+	if (ret)
+		return ret;
+
+	if (!READ_ONCE(mb->storm_stopped))
+		schedule_delayed_work(&mb->storm_work,
+				      RTL8365MB_STORM_IRQ_HOLDOFF_JIFFIES);
+
+	return 0;
+}
+
 static irqreturn_t rtl8365mb_irq(int irq, void *data)
 {
 	struct realtek_priv *priv = data;
 	unsigned long line_changes = 0;
+	bool handled = false;
 	u32 stat;
 	int line;
 	int ret;
@@ -2304,6 +7318,22 @@ static irqreturn_t rtl8365mb_irq(int irq, void *data)
 	if (ret)
 		goto out_error;
 
+	if (stat & RTL8365MB_INTR_LEARN_OVER_MASK) {
+		ret = rtl8365mb_learn_over_handle(priv);
+		if (ret)
+			goto out_error;
+
+		handled = true;
+	}
+
+	if (stat & RTL8365MB_INTR_METER_EXCEEDED_MASK) {
+		ret = rtl8365mb_meter_exceed_handle(priv);
+		if (ret)
+			goto out_error;
+
+		handled = true;
+	}
+
 	if (stat & RTL8365MB_INTR_LINK_CHANGE_MASK) {
 		u32 linkdown_ind;
 		u32 linkup_ind;
@@ -2327,7 +7357,7 @@ static irqreturn_t rtl8365mb_irq(int irq, void *data)
 	}
 
 	if (!line_changes)
-		goto out_none;
+		return handled ? IRQ_HANDLED : IRQ_NONE;
 
 	for_each_set_bit(line, &line_changes, priv->num_ports) {
 		int child_irq = irq_find_mapping(priv->irqdomain, line);
@@ -2340,7 +7370,6 @@ static irqreturn_t rtl8365mb_irq(int irq, void *data)
 out_error:
 	dev_err(priv->dev, "failed to read interrupt status: %d\n", ret);
 
-out_none:
 	return IRQ_NONE;
 }
 
@@ -2375,10 +7404,12 @@ static const struct irq_domain_ops rtl8365mb_irqdomain_ops = {
 
 static int rtl8365mb_set_irq_enable(struct realtek_priv *priv, bool enable)
 {
-	return regmap_update_bits(priv->map, RTL8365MB_INTR_CTRL_REG,
-				  RTL8365MB_INTR_LINK_CHANGE_MASK,
-				  FIELD_PREP(RTL8365MB_INTR_LINK_CHANGE_MASK,
-					     enable ? 1 : 0));
+	u32 mask = RTL8365MB_INTR_LINK_CHANGE_MASK |
+		   RTL8365MB_INTR_LEARN_OVER_MASK |
+		   RTL8365MB_INTR_METER_EXCEEDED_MASK;
+
+	return regmap_update_bits(priv->map, RTL8365MB_INTR_CTRL_REG, mask,
+				  enable ? mask : 0);
 }
 
 static int rtl8365mb_irq_enable(struct realtek_priv *priv)
@@ -2532,6 +7563,19 @@ static void rtl8365mb_irq_teardown(struct realtek_priv *priv)
 	}
 }
 
+/* The exceed handler masks its interrupt and leaves it to storm_work to
+ * unmask it again. Keep both from doing so before the IRQ is released, then
+ * wait for the work once the handler can no longer queue it.
+ */
+static void rtl8365mb_storm_irq_teardown(struct realtek_priv *priv)
+{
+	struct rtl8365mb *mb = priv->chip_data;
+
+	WRITE_ONCE(mb->storm_stopped, true);
+	rtl8365mb_irq_teardown(priv);
+	cancel_delayed_work_sync(&mb->storm_work);
+}
+
 static int rtl8365mb_cpu_config(struct realtek_priv *priv)
 {
 	struct rtl8365mb *mb = priv->chip_data;
@@ -2625,6 +7669,7 @@ static int rtl8365mb_switch_init(struct realtek_priv *priv)
 static int rtl8365mb_reset_chip(struct realtek_priv *priv)
 {
 	u32 val;
+	int ret;
 
 	priv->write_reg_noack(priv, RTL8365MB_CHIP_RESET_REG,
 			      FIELD_PREP(RTL8365MB_CHIP_RESET_HW_MASK, 1));
@@ -2633,9 +7678,13 @@ static int rtl8365mb_reset_chip(struct realtek_priv *priv)
 	 * for 100 ms before accessing any registers to prevent ACK timeouts.
 	 */
 	msleep(100);
-	return regmap_read_poll_timeout(priv->map, RTL8365MB_CHIP_RESET_REG, val,
-					!(val & RTL8365MB_CHIP_RESET_HW_MASK),
-					20000, 1e6);
+	ret = regmap_read_poll_timeout(priv->map, RTL8365MB_CHIP_RESET_REG, val,
+				       !(val & RTL8365MB_CHIP_RESET_HW_MASK),
+				       20000, 1e6);
+
+	rtl83xx_table_invalidate(priv);
+
+	return ret;
 }
 
 /* VLAN support is always enabled in the switch.
@@ -2654,6 +7703,7 @@ static int rtl8365mb_vlan_init(struct dsa_switch *ds)
 {
 	u16 vlan_entry[RTL8365MB_VLAN_MC_CONF_ENTRY_SIZE] = {0};
 	struct realtek_priv *priv = ds->priv;
+	struct rtl8365mb *mb = priv->chip_data;
 	struct switchdev_obj_port_vlan vlan;
 	struct rtl8366_vlan_mc vlanmc = {0};
 	struct dsa_port *cpu_dp;
@@ -2697,7 +7747,167 @@ static int rtl8365mb_vlan_init(struct dsa_switch *ds)
 			 RTL8365MB_VLAN_CTRL_REG,
 			 RTL8365MB_VLAN_CTRL_EN_VLAN_MASK,
 			 FIELD_PREP(RTL8365MB_VLAN_CTRL_EN_VLAN_MASK, 1));
-	return ret;
+	if (ret)
+		return ret;
+
+	/* No uplinks until an 802.1ad bridge adds S-tagged members. S-tagged
+	 * frames are then forwarded within the members of their S-VLAN.
+	 */
+	memset(mb->svlan, 0, sizeof(mb->svlan));
+	mb->svlan_uplink = 0;
+	ret = regmap_write(priv->map, RTL8365MB_SVLAN_UPLINK_PORTMASK_REG, 0);
+	if (ret)
+		return ret;
+
+	return regmap_update_bits(priv->map, RTL8365MB_SVLAN_LOOKUP_TYPE_REG,
+				  RTL8365MB_SVLAN_LOOKUP_TYPE_MASK,
+				  RTL8365MB_SVLAN_LOOKUP_TYPE_MASK);
+}
+
+/* Storm control and control plane protection rates in Kbps, zero disables.
+ * Storm control rates and the learning limit apply to every port. Control
+ * plane protection rates apply at ingress of each user port to all frames
+ * of the class, including ARP, IGMP and ND forwarded from host to host.
+ */
+static const struct devlink_param rtl8365mb_devlink_params[] = {
+	DSA_DEVLINK_PARAM_DRIVER(RTL8365MB_DEVLINK_PARAM_ID_STORM_BCAST,
+				 "storm_broadcast_kbps", U32,
+				 BIT(DEVLINK_PARAM_CMODE_RUNTIME)),
+	DSA_DEVLINK_PARAM_DRIVER(RTL8365MB_DEVLINK_PARAM_ID_STORM_MCAST,
+				 "storm_multicast_kbps", U32,
+				 BIT(DEVLINK_PARAM_CMODE_RUNTIME)),
+	DSA_DEVLINK_PARAM_DRIVER(RTL8365MB_DEVLINK_PARAM_ID_STORM_UNKNOWN_MCAST,
+				 "storm_unknown_multicast_kbps", U32,
+				 BIT(DEVLINK_PARAM_CMODE_RUNTIME)),
+	DSA_DEVLINK_PARAM_DRIVER(RTL8365MB_DEVLINK_PARAM_ID_STORM_UNKNOWN_UCAST,
+				 "storm_unknown_unicast_kbps", U32,
+				 BIT(DEVLINK_PARAM_CMODE_RUNTIME)),
+	DSA_DEVLINK_PARAM_DRIVER(RTL8365MB_DEVLINK_PARAM_ID_COPP_ARP,
+				 "copp_arp_kbps", U32,
+				 BIT(DEVLINK_PARAM_CMODE_RUNTIME)),
+	DSA_DEVLINK_PARAM_DRIVER(RTL8365MB_DEVLINK_PARAM_ID_COPP_IGMP,
+				 "copp_igmp_kbps", U32,
+				 BIT(DEVLINK_PARAM_CMODE_RUNTIME)),
+	DSA_DEVLINK_PARAM_DRIVER(RTL8365MB_DEVLINK_PARAM_ID_COPP_NDISC,
+				 "copp_ndisc_kbps", U32,
+				 BIT(DEVLINK_PARAM_CMODE_RUNTIME)),
+	DSA_DEVLINK_PARAM_DRIVER(RTL8365MB_DEVLINK_PARAM_ID_COPP_LINK_LOCAL,
+				 "copp_link_local_kbps", U32,
+				 BIT(DEVLINK_PARAM_CMODE_RUNTIME)),
+	DSA_DEVLINK_PARAM_DRIVER(RTL8365MB_DEVLINK_PARAM_ID_LEARNING_LIMIT,
+				 "learning_limit", U32,
+				 BIT(DEVLINK_PARAM_CMODE_RUNTIME)),
+	DSA_DEVLINK_PARAM_DRIVER(RTL8365MB_DEVLINK_PARAM_ID_LEARNING_OVERFLOW_ACTION,
+				 "learning_overflow_action", STRING,
+				 BIT(DEVLINK_PARAM_CMODE_RUNTIME)),
+};
+
+static int rtl8365mb_devlink_param_get(struct dsa_switch *ds, u32 id,
+				       struct devlink_param_gset_ctx *ctx)
+{
+	struct realtek_priv *priv = ds->priv;
+	struct rtl8365mb *mb = priv->chip_data;
+
+	switch (id) {
+	case RTL8365MB_DEVLINK_PARAM_ID_STORM_BCAST:
+	case RTL8365MB_DEVLINK_PARAM_ID_STORM_MCAST:
+	case RTL8365MB_DEVLINK_PARAM_ID_STORM_UNKNOWN_MCAST:
+	case RTL8365MB_DEVLINK_PARAM_ID_STORM_UNKNOWN_UCAST:
+		ctx->val.vu32 = mb->storm_kbps[id -
+			RTL8365MB_DEVLINK_PARAM_ID_STORM_BCAST];
+		return 0;
+	case RTL8365MB_DEVLINK_PARAM_ID_COPP_ARP:
+	case RTL8365MB_DEVLINK_PARAM_ID_COPP_IGMP:
+	case RTL8365MB_DEVLINK_PARAM_ID_COPP_NDISC:
+	case RTL8365MB_DEVLINK_PARAM_ID_COPP_LINK_LOCAL:
+		ctx->val.vu32 = mb->copp_kbps[id -
+			RTL8365MB_DEVLINK_PARAM_ID_COPP_ARP];
+		return 0;
+	case RTL8365MB_DEVLINK_PARAM_ID_LEARNING_LIMIT:
+		ctx->val.vu32 = mb->learn_limit;
+		return 0;
+	case RTL8365MB_DEVLINK_PARAM_ID_LEARNING_OVERFLOW_ACTION:
+		strscpy(ctx->val.vstr,
+			rtl8365mb_learn_over_act_names[mb->learn_over_act],
+			sizeof(ctx->val.vstr));
+		return 0;
+	default:
+		return -EOPNOTSUPP;
+	}
+}
+
+static int rtl8365mb_devlink_param_set(struct dsa_switch *ds, u32 id,
+				       struct devlink_param_gset_ctx *ctx)
+{
+	switch (id) {
+	case RTL8365MB_DEVLINK_PARAM_ID_STORM_BCAST:
+	case RTL8365MB_DEVLINK_PARAM_ID_STORM_MCAST:
+	case RTL8365MB_DEVLINK_PARAM_ID_STORM_UNKNOWN_MCAST:
+	case RTL8365MB_DEVLINK_PARAM_ID_STORM_UNKNOWN_UCAST:
+		return rtl8365mb_storm_set(ds->priv,
+					   id - RTL8365MB_DEVLINK_PARAM_ID_STORM_BCAST,
+					   ctx->val.vu32);
+	case RTL8365MB_DEVLINK_PARAM_ID_COPP_ARP:
+	case RTL8365MB_DEVLINK_PARAM_ID_COPP_IGMP:
+	case RTL8365MB_DEVLINK_PARAM_ID_COPP_NDISC:
+	case RTL8365MB_DEVLINK_PARAM_ID_COPP_LINK_LOCAL:
+		return rtl8365mb_copp_set(ds->priv,
+					  id - RTL8365MB_DEVLINK_PARAM_ID_COPP_ARP,
+					  ctx->val.vu32);
+	case RTL8365MB_DEVLINK_PARAM_ID_LEARNING_LIMIT:
+		return rtl8365mb_learn_limit_set(ds->priv, ctx->val.vu32);
+	case RTL8365MB_DEVLINK_PARAM_ID_LEARNING_OVERFLOW_ACTION:
+		return rtl8365mb_learn_over_act_set(ds->priv, ctx->val.vstr);
+	default:
+		return -EOPNOTSUPP;
+	}
+}
+
+static int rtl8365mb_devlink_setup(struct realtek_priv *priv)
+{
+	struct devlink_resource_size_params size_params;
+	struct dsa_switch *ds = &priv->ds;
+	int ret;
+
+	devlink_resource_size_params_init(&size_params,
+					  RTL8365MB_NUM_ACL_RULES,
+					  RTL8365MB_NUM_ACL_RULES, 1,
+					  DEVLINK_RESOURCE_UNIT_ENTRY);
+
+	ret = dsa_devlink_resource_register(ds, "acl_rules",
+					    RTL8365MB_NUM_ACL_RULES,
+					    RTL8365MB_RESOURCE_ID_ACL_RULES,
+					    DEVLINK_RESOURCE_ID_PARENT_TOP,
+					    &size_params);
+	if (ret) {
+		dev_err(priv->dev, "failed to register devlink resources: %d\n",
+			ret);
+		return ret;
+	}
+
+	dsa_devlink_resource_occ_get_register(ds,
+					      RTL8365MB_RESOURCE_ID_ACL_RULES,
+					      rtl8365mb_acl_occ_get, priv);
+
+	ret = dsa_devlink_params_register(ds, rtl8365mb_devlink_params,
+					  ARRAY_SIZE(rtl8365mb_devlink_params));
+	if (ret) {
+		dev_err(priv->dev, "failed to register devlink params: %d\n",
+			ret);
+		dsa_devlink_resources_unregister(ds);
+		return ret;
+	}
+
+	return 0;
+}
+
+static void rtl8365mb_devlink_teardown(struct realtek_priv *priv)
+{
+	struct dsa_switch *ds = &priv->ds;
+
+	dsa_devlink_params_unregister(ds, rtl8365mb_devlink_params,
+				      ARRAY_SIZE(rtl8365mb_devlink_params));
+	dsa_devlink_resources_unregister(ds);
 }
 
 static int rtl8365mb_setup(struct dsa_switch *ds)
@@ -2715,6 +7925,16 @@ static int rtl8365mb_setup(struct dsa_switch *ds)
 
 	/* Table access mutex */
 	mutex_init(&mb->table_lock);
+	mutex_init(&mb->meter_lock);
+	mutex_init(&mb->acl_lock);
+	mutex_init(&mb->l2_lock);
+	hash_init(mb->l2_index);
+	hash_init(mb->l2_mc);
+	memset(mb->meters, 0, sizeof(mb->meters));
+	memset(mb->queue_maps, 0, sizeof(mb->queue_maps));
+	INIT_LIST_HEAD(&mb->flower_rules);
+	rtl8365mb_storm_init(priv);
+	rtl8365mb_copp_init(priv);
 
 	ret = rtl8365mb_reset_chip(priv);
 	if (ret) {
@@ -2742,10 +7962,6 @@ static int rtl8365mb_setup(struct dsa_switch *ds)
 	dsa_switch_for_each_cpu_port(cpu_dp, ds) {
 		cpu->mask |= BIT(cpu_dp->index);
 
-		/* Forward to all user ports */
-		ret = rtl8365mb_port_set_isolation(priv, cpu_dp->index,
-						   user_ports);
-
 		if (cpu->trap_port == RTL8365MB_MAX_NUM_PORTS)
 			cpu->trap_port = cpu_dp->index;
 	}
@@ -2754,6 +7970,18 @@ static int rtl8365mb_setup(struct dsa_switch *ds)
 	if (ret)
 		goto out_teardown_irq;
 
+	/* CPU ports forward to all user ports, user ports only to the CPU */
+	ret = rtl8365mb_port_isolation_apply(priv);
+	if (ret)
+		goto out_teardown_irq;
+
+	bitmap_zero(mb->fid_map, RTL8365MB_NUM_FIDS);
+	__set_bit(RTL8365MB_FID_DEFAULT, mb->fid_map);
+
+	ret = rtl8365mb_learn_limit_setup(priv);
+	if (ret)
+		goto out_teardown_irq;
+
 	/* Configure ports */
 	for (i = 0; i < priv->num_ports; i++) {
 		struct rtl8365mb_port *p = &mb->ports[i];
@@ -2762,8 +7990,12 @@ static int rtl8365mb_setup(struct dsa_switch *ds)
 			continue;
 
 		if ((cpu->mask & BIT(i)) == 0) {
-			/* Forward only to the CPU */
-			ret = rtl8365mb_port_set_isolation(priv, i, cpu->mask);
+			/* Learn in a private FID while standalone */
+			ret = rtl8365mb_fid_alloc(mb);
+			if (ret < 0)
+				goto out_teardown_irq;
+
+			ret = rtl8365mb_port_set_fid(priv, i, ret);
 			if (ret)
 				goto out_teardown_irq;
 		}
@@ -2773,6 +8005,24 @@ static int rtl8365mb_setup(struct dsa_switch *ds)
 		if (ret)
 			goto out_teardown_irq;
 
+		/* No ingress rate limit until a policer is offloaded */
+		ret = rtl8365mb_port_set_ingress_rate(priv, i,
+						      RTL8365MB_PORT_INGRESSBW_RATE_MAX);
+		if (ret)
+			goto out_teardown_irq;
+
+		/* No egress rate limit until a shaper is offloaded */
+		ret = rtl8365mb_port_set_egress_rate(priv, i,
+						     RTL8365MB_PORT_EGRESSBW_RATE_MAX);
+		if (ret)
+			goto out_teardown_irq;
+
+		/* A single egress queue until an ets qdisc is offloaded */
+		ret = rtl8365mb_port_set_num_queues(priv, i, 1);
+		if (ret)
+			goto out_teardown_irq;
+		p->num_queues = 1;
+
 		/* Set the initial STP state of all ports to DISABLED, otherwise
 		 * ports will still forward frames to the CPU despite being
 		 * administratively down by default.
@@ -2784,6 +8034,18 @@ static int rtl8365mb_setup(struct dsa_switch *ds)
 		p->index = i;
 	}
 
+	ret = regmap_write(priv->map, RTL8365MB_PORT_PBFIDEN_REG, user_ports);
+	if (ret)
+		goto out_teardown_irq;
+
+	/* tc expresses shaping rates in layer 2 bytes, so leave the
+	 * interframe gap and preamble out of the egress accounting
+	 */
+	ret = regmap_update_bits(priv->map, RTL8365MB_SCHEDULE_WFQ_CTRL_REG,
+				 RTL8365MB_SCHEDULE_WFQ_CTRL_IFG_MASK, 0);
+	if (ret)
+		goto out_teardown_irq;
+
 	ret = rtl8365mb_port_change_mtu(ds, cpu->trap_port, ETH_DATA_LEN);
 	if (ret)
 		goto out_teardown_irq;
@@ -2792,22 +8054,65 @@ static int rtl8365mb_setup(struct dsa_switch *ds)
 	if (ret)
 		goto out_teardown_irq;
 
+	ret = rtl8365mb_mdb_setup(priv);
+	if (ret)
+		goto out_teardown_irq;
+
+	ret = rtl8365mb_flood_setup(priv);
+	if (ret)
+		goto out_teardown_irq;
+
+	ret = rtl8365mb_acl_setup(priv);
+	if (ret)
+		goto out_teardown_irq;
+
+	ret = rtl8365mb_qos_setup(priv);
+	if (ret)
+		goto out_teardown_irq;
+
+	ret = rtl8365mb_devlink_setup(priv);
+	if (ret)
+		goto out_teardown_irq;
+
 	/* vlan config will only be effective for ports with vlan filtering */
 	ds->configure_vlan_while_not_filtering = 1;
 
+	/* Addresses are kept apart per bridge and per standalone port FID */
+	ds->max_num_bridges = RTL8365MB_MAX_NUM_BRIDGES;
+	ds->fdb_isolation = true;
+
+	/* Addresses learned by the software bridge from foreign interfaces
+	 * are installed towards the CPU instead of flooding traffic to them
+	 */
+	ds->assisted_learning_on_cpu_port = true;
+
+	/* The bridge is told about the range of the ageing timer */
+	ds->ageing_time_min = RTL8365MB_AGEING_TIME_MIN;
+	ds->ageing_time_max = RTL8365MB_AGEING_TIME_MAX;
+
 	ret = rtl83xx_setup_user_mdio(ds);
 	if (ret) {
 		dev_err(priv->dev, "could not set up MDIO bus\n");
-		goto out_teardown_irq;
+		goto out_devlink_teardown;
 	}
 
 	/* Start statistics counter polling */
 	rtl8365mb_stats_setup(priv);
 
+	/* Start reporting hardware learned addresses to the bridge */
+	rtl8365mb_l2_scan_setup(priv);
+
+	/* Start ACL counter polling */
+	schedule_delayed_work(&mb->acl_stats_work,
+			      RTL8365MB_STATS_INTERVAL_JIFFIES);
+
 	return 0;
 
+out_devlink_teardown:
+	rtl8365mb_devlink_teardown(priv);
+
 out_teardown_irq:
-	rtl8365mb_irq_teardown(priv);
+	rtl8365mb_storm_irq_teardown(priv);
 
 out_error:
 	return ret;
@@ -2816,9 +8121,17 @@ out_error:
 static void rtl8365mb_teardown(struct dsa_switch *ds)
 {
 	struct realtek_priv *priv = ds->priv;
+	struct rtl8365mb *mb = priv->chip_data;
 
+	rtl8365mb_l2_scan_teardown(priv);
+	cancel_delayed_work_sync(&mb->acl_stats_work);
 	rtl8365mb_stats_teardown(priv);
-	rtl8365mb_irq_teardown(priv);
+	rtl8365mb_storm_irq_teardown(priv);
+	rtl8365mb_l2_index_flush(mb);
+	rtl8365mb_mdb_teardown(mb);
+	rtl8365mb_storm_teardown(priv);
+	rtl8365mb_copp_teardown(priv);
+	rtl8365mb_devlink_teardown(priv);
 }
 
 static int rtl8365mb_get_chip_id_and_ver(struct regmap *map, u32 *id, u32 *ver)
@@ -2917,10 +8230,33 @@ static const struct dsa_switch_ops rtl8365mb_switch_ops = {
 	.port_vlan_add = rtl8365mb_vlan_add,
 	.port_vlan_del = rtl8365mb_vlan_del,
 	.port_vlan_filtering = rtl8365mb_vlan_filtering,
+	.port_fdb_add = rtl8365mb_port_fdb_add,
+	.port_fdb_del = rtl8365mb_port_fdb_del,
+	.port_fdb_dump = rtl8365mb_port_fdb_dump,
+	.port_mdb_add = rtl8365mb_port_mdb_add,
+	.port_mdb_del = rtl8365mb_port_mdb_del,
+	.port_fast_age = rtl8365mb_port_fast_age,
+	.set_ageing_time = rtl8365mb_set_ageing_time,
+	.cls_flower_add = rtl8365mb_cls_flower_add,
+	.cls_flower_del = rtl8365mb_cls_flower_del,
+	.cls_flower_stats = rtl8365mb_cls_flower_stats,
+	.port_policer_add = rtl8365mb_port_policer_add,
+	.port_policer_del = rtl8365mb_port_policer_del,
+	.port_setup_tc = rtl8365mb_port_setup_tc,
+	.port_get_default_prio = rtl8365mb_port_get_default_prio,
+	.port_set_default_prio = rtl8365mb_port_set_default_prio,
+	.port_get_dscp_prio = rtl8365mb_port_get_dscp_prio,
+	.port_add_dscp_prio = rtl8365mb_port_add_dscp_prio,
+	.port_del_dscp_prio = rtl8365mb_port_del_dscp_prio,
+	.port_get_apptrust = rtl8365mb_port_get_apptrust,
+	.port_set_apptrust = rtl8365mb_port_set_apptrust,
+	.devlink_param_get = rtl8365mb_devlink_param_get,
+	.devlink_param_set = rtl8365mb_devlink_param_set,
 	.port_bridge_join = rtl8365mb_port_bridge_join,
 	.port_bridge_leave = rtl8365mb_port_bridge_leave,
 	.port_bridge_flags = rtl8365mb_port_bridge_flags,
 	.port_pre_bridge_flags = rtl8365mb_port_pre_bridge_flags,
+	.port_set_host_flood = rtl8365mb_port_set_host_flood,
 };
 
 static const struct realtek_ops rtl8365mb_ops = {
@@ -205,8 +205,6 @@
 #define RTL8366RB_PORT_STATUS_RXPAUSE_MASK	0x0040
 #define RTL8366RB_PORT_STATUS_AN_MASK		0x0080
 
-#define RTL8366RB_NUM_VLANS		16
-#define RTL8366RB_NUM_VIDS		4096
 #define RTL8366RB_PRIORITYMAX		7
 #define RTL8366RB_NUM_FIDS		8
 #define RTL8366RB_FIDMAX		7
@@ -268,10 +266,11 @@
 #define RTL8366RB_EB_PREIFG		BIT(9)
 
 #define RTL8366RB_BDTH_SW_MAX		1048512 /* 1048576? */
+/* A bandwidth of N allows (N + 1) * 64 Kbps, the largest one no limit */
 #define RTL8366RB_BDTH_UNIT		64
 #define RTL8366RB_BDTH_REG_DEFAULT	16383
 
-/* QOS */
+/* QOS, enabled in RTL8366RB_SGCR */
 #define RTL8366RB_QOS			BIT(15)
 /* Include/Exclude Preamble and IFG (20 bytes). 0:Exclude, 1:Include. */
 #define RTL8366RB_QOS_DEFAULT_PREIFG	1
@@ -793,6 +792,40 @@ static int rtl8366rb_setup_all_leds_off(struct realtek_priv *priv)
 	return ret;
 }
 
+static int rtl8366rb_port_set_isolation(struct realtek_priv *priv, int port,
+					u32 mask)
+{
+	return regmap_write(priv->map, RTL8366RB_PORT_ISO(port),
+			    RTL8366RB_PORT_ISO_PORTS(mask) | RTL8366RB_PORT_ISO_EN);
+}
+
+/* User ports can only send packets to the CPU port and the other ports of
+ * their bridge, the CPU port can send packets to all user ports. Isolated
+ * ports cannot send packets to each other, only to the non-isolated ports of
+ * their bridge.
+ */
+static int rtl8366rb_port_isolation_apply(struct realtek_priv *priv)
+{
+	struct rtl8366rb *rb = priv->chip_data;
+	struct dsa_switch *ds = &priv->ds;
+	u32 iso[RTL8366RB_NUM_PORTS];
+	int i, j;
+
+	for (i = 0; i < RTL8366RB_PORT_NUM_CPU; i++) {
+		iso[i] = BIT(RTL8366RB_PORT_NUM_CPU);
+
+		for (j = 0; j < RTL8366RB_PORT_NUM_CPU; j++)
+			if (j != i && dsa_port_bridge_same(dsa_to_port(ds, i),
+							   dsa_to_port(ds, j)) &&
+			    !(rb->isolated & BIT(i) && rb->isolated & BIT(j)))
+				iso[i] |= BIT(j);
+	}
+	iso[RTL8366RB_PORT_NUM_CPU] = dsa_user_ports(ds);
+
+	return rtl83xx_port_isolation_commit(priv, rb->isolation, iso,
+					     rtl8366rb_port_set_isolation);
+}
+
 static int rtl8366rb_setup(struct dsa_switch *ds)
 {
 	struct realtek_priv *priv = ds->priv;
@@ -868,18 +901,10 @@ static int rtl8366rb_setup(struct dsa_switch *ds)
 	if (ret)
 		return ret;
 
-	/* Isolate all user ports so they can only send packets to itself and the CPU port */
-	for (i = 0; i < RTL8366RB_PORT_NUM_CPU; i++) {
-		ret = regmap_write(priv->map, RTL8366RB_PORT_ISO(i),
-				   RTL8366RB_PORT_ISO_PORTS(BIT(RTL8366RB_PORT_NUM_CPU)) |
-				   RTL8366RB_PORT_ISO_EN);
-		if (ret)
-			return ret;
-	}
-	/* CPU port can send packets to all ports */
-	ret = regmap_write(priv->map, RTL8366RB_PORT_ISO(RTL8366RB_PORT_NUM_CPU),
-			   RTL8366RB_PORT_ISO_PORTS(dsa_user_ports(ds)) |
-			   RTL8366RB_PORT_ISO_EN);
+	/* Isolate all user ports so they can only send packets to the CPU
+	 * port, the CPU port can send packets to all ports
+	 */
+	ret = rtl8366rb_port_isolation_apply(priv);
 	if (ret)
 		return ret;
 
@@ -974,6 +999,14 @@ static int rtl8366rb_setup(struct dsa_switch *ds)
 	if (ret)
 		return ret;
 
+	/* No ingress rate limits until a policer is offloaded */
+	for (i = 0; i < RTL8366RB_NUM_PORTS; i++) {
+		ret = regmap_write(priv->map, RTL8366RB_IB_REG(i),
+				   RTL8366RB_BDTH_REG_DEFAULT);
+		if (ret)
+			return ret;
+	}
+
 	/* Don't drop packets whose DA has not been learned */
 	ret = regmap_update_bits(priv->map, RTL8366RB_SSCR2,
 				 RTL8366RB_SSCR2_DROP_UNKNOWN_DA, 0);
@@ -1193,31 +1226,13 @@ rtl8366rb_port_bridge_join(struct dsa_switch *ds, int port,
 			   struct netlink_ext_ack *extack)
 {
 	struct realtek_priv *priv = ds->priv;
-	unsigned int port_bitmap = 0;
-	int ret, i;
-
-	/* Loop over all other ports than the current one */
-	for (i = 0; i < RTL8366RB_PORT_NUM_CPU; i++) {
-		/* Current port handled last */
-		if (i == port)
-			continue;
-		/* Not on this bridge */
-		if (!dsa_port_offloads_bridge(dsa_to_port(ds, i), &bridge))
-			continue;
-		/* Join this port to each other port on the bridge */
-		ret = regmap_update_bits(priv->map, RTL8366RB_PORT_ISO(i),
-					 RTL8366RB_PORT_ISO_PORTS(BIT(port)),
-					 RTL8366RB_PORT_ISO_PORTS(BIT(port)));
-		if (ret)
-			dev_err(priv->dev, "failed to join port %d\n", port);
+	int ret;
 
-		port_bitmap |= BIT(i);
-	}
+	ret = rtl8366rb_port_isolation_apply(priv);
+	if (ret)
+		NL_SET_ERR_MSG_MOD(extack, "Failed to update port isolation");
 
-	/* Set the bits for the ports we can access */
-	return regmap_update_bits(priv->map, RTL8366RB_PORT_ISO(port),
-				  RTL8366RB_PORT_ISO_PORTS(port_bitmap),
-				  RTL8366RB_PORT_ISO_PORTS(port_bitmap));
+	return ret;
 }
 
 static void
@@ -1225,29 +1240,17 @@ rtl8366rb_port_bridge_leave(struct dsa_switch *ds, int port,
 			    struct dsa_bridge bridge)
 {
 	struct realtek_priv *priv = ds->priv;
-	unsigned int port_bitmap = 0;
-	int ret, i;
+	struct rtl8366rb *rb = priv->chip_data;
 
-	/* Loop over all other ports than this one */
-	for (i = 0; i < RTL8366RB_PORT_NUM_CPU; i++) {
-		/* Current port handled last */
-		if (i == port)
-			continue;
-		/* Not on this bridge */
-		if (!dsa_port_offloads_bridge(dsa_to_port(ds, i), &bridge))
-			continue;
-		/* Remove this port from any other port on the bridge */
-		ret = regmap_update_bits(priv->map, RTL8366RB_PORT_ISO(i),
-					 RTL8366RB_PORT_ISO_PORTS(BIT(port)), 0);
-		if (ret)
-			dev_err(priv->dev, "failed to leave port %d\n", port);
-
-		port_bitmap |= BIT(i);
-	}
+	/* BR_ISOLATED is not cleared by DSA on leave, and must not carry over
+	 * to the next bridge
+	 */
+	rb->isolated &= ~BIT(port);
 
-	/* Clear the bits for the ports we can not access, leave ourselves */
-	regmap_update_bits(priv->map, RTL8366RB_PORT_ISO(port),
-			   RTL8366RB_PORT_ISO_PORTS(port_bitmap), 0);
+	/* The port is already unbridged, so the new matrix isolates it from
+	 * its former bridge peers. A failure leaves the old matrix in place.
+	 */
+	rtl8366rb_port_isolation_apply(priv);
 }
 
 /**
@@ -1270,7 +1273,9 @@ static int rtl8366rb_vlan_filtering(struct dsa_switch *ds, int port,
 				    struct netlink_ext_ack *extack)
 {
 	struct realtek_priv *priv = ds->priv;
+	struct net_device *br;
 	struct rtl8366rb *rb;
+	u16 proto;
 	int ret;
 
 	rb = priv->chip_data;
@@ -1278,6 +1283,16 @@ static int rtl8366rb_vlan_filtering(struct dsa_switch *ds, int port,
 	dev_dbg(priv->dev, "port %d: %s VLAN filtering\n", port,
 		vlan_filtering ? "enable" : "disable");
 
+	/* The member configurations carry S-tag fields, but how the chip uses
+	 * them is not documented: leave 802.1ad bridges to software.
+	 */
+	br = dsa_port_bridge_dev_get(dsa_to_port(ds, port));
+	if (vlan_filtering && br && !br_vlan_get_proto(br, &proto) &&
+	    proto == ETH_P_8021AD) {
+		NL_SET_ERR_MSG_MOD(extack, "802.1ad bridges are not supported");
+		return -EOPNOTSUPP;
+	}
+
 	/* If the port is not in the member set, the frame will be dropped */
 	ret = regmap_update_bits(priv->map, RTL8366RB_VLAN_INGRESS_CTRL2_REG,
 				 BIT(port), vlan_filtering ? BIT(port) : 0);
@@ -1301,8 +1316,8 @@ rtl8366rb_port_pre_bridge_flags(struct dsa_switch *ds, int port,
 				struct switchdev_brport_flags flags,
 				struct netlink_ext_ack *extack)
 {
-	/* We support enabling/disabling learning */
-	if (flags.mask & ~(BR_LEARNING))
+	/* We support enabling/disabling learning and port isolation */
+	if (flags.mask & ~(BR_LEARNING | BR_ISOLATED))
 		return -EINVAL;
 
 	return 0;
@@ -1324,6 +1339,22 @@ rtl8366rb_port_bridge_flags(struct dsa_switch *ds, int port,
 			return ret;
 	}
 
+	if (flags.mask & BR_ISOLATED) {
+		struct rtl8366rb *rb = priv->chip_data;
+		u32 isolated = rb->isolated;
+
+		if (flags.val & BR_ISOLATED)
+			rb->isolated |= BIT(port);
+		else
+			rb->isolated &= ~BIT(port);
+
+		ret = rtl8366rb_port_isolation_apply(priv);
+		if (ret) {
+			rb->isolated = isolated;
+			return ret;
+		}
+	}
+
 	return 0;
 }
 
@@ -1431,43 +1462,116 @@ static int rtl8366rb_max_mtu(struct dsa_switch *ds, int port)
 	return 16000 - VLAN_ETH_HLEN - ETH_FCS_LEN;
 }
 
+static int rtl8366rb_port_policer_add(struct dsa_switch *ds, int port,
+				      struct dsa_mall_policer_tc_entry *policer)
+{
+	struct realtek_priv *priv = ds->priv;
+	u64 units;
+	u32 bdth;
+	int ret;
+
+	/* Round the rate up to the 64 Kbps granularity. Rates beyond the
+	 * largest one are above the port speed and need no limit at all.
+	 */
+	units = DIV_ROUND_UP_ULL(policer->rate_bytes_per_sec * 8,
+				 RTL8366RB_BDTH_UNIT * 1000);
+	bdth = min_t(u64, max_t(u64, units, 1) - 1,
+		     RTL8366RB_BDTH_REG_DEFAULT);
+
+	/* The bandwidth control is part of the QoS block */
+	ret = regmap_update_bits(priv->map, RTL8366RB_SGCR, RTL8366RB_QOS,
+				 RTL8366RB_QOS);
+	if (ret)
+		return ret;
+
+	/* tc expresses rates in layer 2 bytes, so leave the interframe gap
+	 * and preamble out of the accounting. The bucket size is fixed.
+	 */
+	return regmap_update_bits(priv->map, RTL8366RB_IB_REG(port),
+				  RTL8366RB_IB_BDTH_MASK | RTL8366RB_IB_PREIFG,
+				  bdth);
+}
+
+static void rtl8366rb_port_policer_del(struct dsa_switch *ds, int port)
+{
+	struct realtek_priv *priv = ds->priv;
+	int ret;
+
+	ret = regmap_update_bits(priv->map, RTL8366RB_IB_REG(port),
+				 RTL8366RB_IB_BDTH_MASK | RTL8366RB_IB_PREIFG,
+				 RTL8366RB_BDTH_REG_DEFAULT);
+	if (ret)
+		dev_err(priv->dev, "failed to remove policer on port %d: %d\n",
+			port, ret);
+}
+
+/* The VID is both the table address and the first data word */
+static const struct rtl83xx_table_desc rtl8366rb_vlan_table = {
+	.ctrl_reg = RTL8366RB_TABLE_ACCESS_CTRL_REG,
+	.addr_reg = RTL8366RB_VLAN_TABLE_WRITE_BASE,
+	.addr_mask = RTL8366RB_VLAN_VID_MASK,
+	.wdata_reg = RTL8366RB_VLAN_TABLE_WRITE_BASE,
+	.rdata_reg = RTL8366RB_VLAN_TABLE_READ_BASE,
+	.entry_size = RTL8366RB_VLAN_ENTRY_SIZE,
+	.cmd_read = RTL8366RB_TABLE_VLAN_READ_CTRL,
+	.cmd_write = RTL8366RB_TABLE_VLAN_WRITE_CTRL,
+	.flags = RTL83XX_TABLE_ADDR_IN_DATA,
+};
+
+static void rtl8366rb_vlan_cache_invalidate(struct realtek_priv *priv)
+{
+	struct rtl8366rb *rb = priv->chip_data;
+	struct rtl8366rb_vlan_cache *vc = &rb->vlan_cache;
+
+	bitmap_zero(vc->vlan4k_valid, RTL8366RB_NUM_VIDS);
+	bitmap_zero(vc->vlanmc_valid, RTL8366RB_NUM_VLANS);
+	vc->port_vlan_ctrl_valid = false;
+}
+
+static int rtl8366rb_vlan4k_load(struct realtek_priv *priv, u32 vid)
+{
+	struct rtl8366rb *rb = priv->chip_data;
+	struct rtl8366rb_vlan_cache *vc = &rb->vlan_cache;
+	u16 data[RTL8366RB_VLAN_ENTRY_SIZE];
+	int ret;
+
+	if (test_bit(vid, vc->vlan4k_valid))
+		return 0;
+
+	ret = rtl83xx_table_read(priv, &rtl8366rb_vlan_table, vid, data, 1);
+	if (ret)
+		return ret;
+
+	/* The first word only holds the VID, which is the cache index */
+	memcpy(vc->vlan4k[vid], &data[1], sizeof(vc->vlan4k[vid]));
+	__set_bit(vid, vc->vlan4k_valid);
+
+	return 0;
+}
+
 static int rtl8366rb_get_vlan_4k(struct realtek_priv *priv, u32 vid,
 				 struct rtl8366_vlan_4k *vlan4k)
 {
-	u32 data[3];
+	struct rtl8366rb *rb = priv->chip_data;
+	u16 *data;
 	int ret;
-	int i;
 
 	memset(vlan4k, '\0', sizeof(struct rtl8366_vlan_4k));
 
 	if (vid >= RTL8366RB_NUM_VIDS)
 		return -EINVAL;
 
-	/* write VID */
-	ret = regmap_write(priv->map, RTL8366RB_VLAN_TABLE_WRITE_BASE,
-			   vid & RTL8366RB_VLAN_VID_MASK);
-	if (ret)
-		return ret;
-
-	/* write table access control word */
-	ret = regmap_write(priv->map, RTL8366RB_TABLE_ACCESS_CTRL_REG,
-			   RTL8366RB_TABLE_VLAN_READ_CTRL);
+	ret = rtl8366rb_vlan4k_load(priv, vid);
 	if (ret)
 		return ret;
 
-	for (i = 0; i < 3; i++) {
-		ret = regmap_read(priv->map,
-				  RTL8366RB_VLAN_TABLE_READ_BASE + i,
-				  &data[i]);
-		if (ret)
-			return ret;
-	}
+	data = rb->vlan_cache.vlan4k[vid];
 
 	vlan4k->vid = vid;
-	vlan4k->untag = (data[1] >> RTL8366RB_VLAN_UNTAG_SHIFT) &
+	vlan4k->untag = (data[0] >> RTL8366RB_VLAN_UNTAG_SHIFT) &
 			RTL8366RB_VLAN_UNTAG_MASK;
-	vlan4k->member = data[1] & RTL8366RB_VLAN_MEMBER_MASK;
-	vlan4k->fid = data[2] & RTL8366RB_VLAN_FID_MASK;
+	vlan4k->member = data[0] & RTL8366RB_VLAN_MEMBER_MASK;
+	vlan4k->fid = data[1] & RTL8366RB_VLAN_FID_MASK;
 
 	return 0;
 }
@@ -1475,9 +1579,10 @@ static int rtl8366rb_get_vlan_4k(struct realtek_priv *priv, u32 vid,
 static int rtl8366rb_set_vlan_4k(struct realtek_priv *priv,
 				 const struct rtl8366_vlan_4k *vlan4k)
 {
-	u32 data[3];
+	struct rtl8366rb *rb = priv->chip_data;
+	struct rtl8366rb_vlan_cache *vc = &rb->vlan_cache;
+	u16 data[RTL8366RB_VLAN_ENTRY_SIZE];
 	int ret;
-	int i;
 
 	if (vlan4k->vid >= RTL8366RB_NUM_VIDS ||
 	    vlan4k->member > RTL8366RB_VLAN_MEMBER_MASK ||
@@ -1491,40 +1596,61 @@ static int rtl8366rb_set_vlan_4k(struct realtek_priv *priv,
 			RTL8366RB_VLAN_UNTAG_SHIFT);
 	data[2] = vlan4k->fid & RTL8366RB_VLAN_FID_MASK;
 
-	for (i = 0; i < 3; i++) {
-		ret = regmap_write(priv->map,
-				   RTL8366RB_VLAN_TABLE_WRITE_BASE + i,
-				   data[i]);
-		if (ret)
-			return ret;
+	if (test_bit(vlan4k->vid, vc->vlan4k_valid) &&
+	    !memcmp(vc->vlan4k[vlan4k->vid], &data[1],
+		    sizeof(vc->vlan4k[vlan4k->vid])))
+		return 0;
+
+	ret = rtl83xx_table_write(priv, &rtl8366rb_vlan_table, vlan4k->vid,
+				  data, 1);
+	if (ret) {
+		__clear_bit(vlan4k->vid, vc->vlan4k_valid);
+		return ret;
 	}
 
-	/* write table access control word */
-	ret = regmap_write(priv->map, RTL8366RB_TABLE_ACCESS_CTRL_REG,
-			   RTL8366RB_TABLE_VLAN_WRITE_CTRL);
+	memcpy(vc->vlan4k[vlan4k->vid], &data[1],
+	       sizeof(vc->vlan4k[vlan4k->vid]));
+	__set_bit(vlan4k->vid, vc->vlan4k_valid);
 
-	return ret;
+	return 0;
+}
+
+static int rtl8366rb_vlanmc_load(struct realtek_priv *priv, u32 index)
+{
+	struct rtl8366rb *rb = priv->chip_data;
+	struct rtl8366rb_vlan_cache *vc = &rb->vlan_cache;
+	int ret;
+
+	if (test_bit(index, vc->vlanmc_valid))
+		return 0;
+
+	ret = regmap_bulk_read(priv->map, RTL8366RB_VLAN_MC_BASE(index),
+			       vc->vlanmc[index], RTL8366RB_VLAN_ENTRY_SIZE);
+	if (ret)
+		return ret;
+
+	__set_bit(index, vc->vlanmc_valid);
+
+	return 0;
 }
 
 static int rtl8366rb_get_vlan_mc(struct realtek_priv *priv, u32 index,
 				 struct rtl8366_vlan_mc *vlanmc)
 {
-	u32 data[3];
+	struct rtl8366rb *rb = priv->chip_data;
+	u16 *data;
 	int ret;
-	int i;
 
 	memset(vlanmc, '\0', sizeof(struct rtl8366_vlan_mc));
 
 	if (index >= RTL8366RB_NUM_VLANS)
 		return -EINVAL;
 
-	for (i = 0; i < 3; i++) {
-		ret = regmap_read(priv->map,
-				  RTL8366RB_VLAN_MC_BASE(index) + i,
-				  &data[i]);
-		if (ret)
-			return ret;
-	}
+	ret = rtl8366rb_vlanmc_load(priv, index);
+	if (ret)
+		return ret;
+
+	data = rb->vlan_cache.vlanmc[index];
 
 	vlanmc->vid = data[0] & RTL8366RB_VLAN_VID_MASK;
 	vlanmc->priority = (data[0] >> RTL8366RB_VLAN_PRIORITY_SHIFT) &
@@ -1540,7 +1666,10 @@ static int rtl8366rb_get_vlan_mc(struct realtek_priv *priv, u32 index,
 static int rtl8366rb_set_vlan_mc(struct realtek_priv *priv, u32 index,
 				 const struct rtl8366_vlan_mc *vlanmc)
 {
-	u32 data[3];
+	struct rtl8366rb *rb = priv->chip_data;
+	struct rtl8366rb_vlan_cache *vc = &rb->vlan_cache;
+	u16 data[RTL8366RB_VLAN_ENTRY_SIZE];
+	bool valid;
 	int ret;
 	int i;
 
@@ -1560,30 +1689,61 @@ static int rtl8366rb_set_vlan_mc(struct realtek_priv *priv, u32 index,
 			RTL8366RB_VLAN_UNTAG_SHIFT);
 	data[2] = vlanmc->fid & RTL8366RB_VLAN_FID_MASK;
 
-	for (i = 0; i < 3; i++) {
+	/* Only write the words that changed */
+	valid = test_bit(index, vc->vlanmc_valid);
+	for (i = 0; i < RTL8366RB_VLAN_ENTRY_SIZE; i++) {
+		if (valid && vc->vlanmc[index][i] == data[i])
+			continue;
+
 		ret = regmap_write(priv->map,
 				   RTL8366RB_VLAN_MC_BASE(index) + i,
 				   data[i]);
-		if (ret)
+		if (ret) {
+			__clear_bit(index, vc->vlanmc_valid);
 			return ret;
+		}
 	}
 
+	memcpy(vc->vlanmc[index], data, sizeof(vc->vlanmc[index]));
+	__set_bit(index, vc->vlanmc_valid);
+
+	return 0;
+}
+
+static int rtl8366rb_port_vlan_ctrl_load(struct realtek_priv *priv)
+{
+	struct rtl8366rb *rb = priv->chip_data;
+	struct rtl8366rb_vlan_cache *vc = &rb->vlan_cache;
+	int ret;
+
+	if (vc->port_vlan_ctrl_valid)
+		return 0;
+
+	ret = regmap_bulk_read(priv->map, RTL8366RB_PORT_VLAN_CTRL_BASE,
+			       vc->port_vlan_ctrl,
+			       RTL8366RB_PORT_VLAN_CTRL_NUM_REGS);
+	if (ret)
+		return ret;
+
+	vc->port_vlan_ctrl_valid = true;
+
 	return 0;
 }
 
 static int rtl8366rb_get_mc_index(struct realtek_priv *priv, int port, int *val)
 {
-	u32 data;
+	struct rtl8366rb *rb = priv->chip_data;
+	u16 data;
 	int ret;
 
 	if (port >= priv->num_ports)
 		return -EINVAL;
 
-	ret = regmap_read(priv->map, RTL8366RB_PORT_VLAN_CTRL_REG(port),
-			  &data);
+	ret = rtl8366rb_port_vlan_ctrl_load(priv);
 	if (ret)
 		return ret;
 
+	data = rb->vlan_cache.port_vlan_ctrl[port / 4];
 	*val = (data >> RTL8366RB_PORT_VLAN_CTRL_SHIFT(port)) &
 		RTL8366RB_PORT_VLAN_CTRL_MASK;
 
@@ -1593,24 +1753,40 @@ static int rtl8366rb_get_mc_index(struct realtek_priv *priv, int port, int *val)
 static int rtl8366rb_set_mc_index(struct realtek_priv *priv, int port, int index)
 {
 	struct dsa_switch *ds = &priv->ds;
+	struct rtl8366rb_vlan_cache *vc;
 	struct rtl8366rb *rb;
 	bool pvid_enabled;
+	u16 data;
 	int ret;
 
 	rb = priv->chip_data;
+	vc = &rb->vlan_cache;
 	pvid_enabled = !!index;
 
 	if (port >= priv->num_ports || index >= RTL8366RB_NUM_VLANS)
 		return -EINVAL;
 
-	ret = regmap_update_bits(priv->map, RTL8366RB_PORT_VLAN_CTRL_REG(port),
-				 RTL8366RB_PORT_VLAN_CTRL_MASK <<
-					RTL8366RB_PORT_VLAN_CTRL_SHIFT(port),
-				 (index & RTL8366RB_PORT_VLAN_CTRL_MASK) <<
-					RTL8366RB_PORT_VLAN_CTRL_SHIFT(port));
+	ret = rtl8366rb_port_vlan_ctrl_load(priv);
 	if (ret)
 		return ret;
 
+	data = vc->port_vlan_ctrl[port / 4];
+	data &= ~(RTL8366RB_PORT_VLAN_CTRL_MASK <<
+		  RTL8366RB_PORT_VLAN_CTRL_SHIFT(port));
+	data |= (index & RTL8366RB_PORT_VLAN_CTRL_MASK) <<
+		RTL8366RB_PORT_VLAN_CTRL_SHIFT(port);
+
+	if (data != vc->port_vlan_ctrl[port / 4]) {
+		ret = regmap_write(priv->map, RTL8366RB_PORT_VLAN_CTRL_REG(port),
+				   data);
+		if (ret) {
+			vc->port_vlan_ctrl_valid = false;
+			return ret;
+		}
+
+		vc->port_vlan_ctrl[port / 4] = data;
+	}
+
 	rb->pvid_enabled[port] = pvid_enabled;
 
 	/* If VLAN filtering is enabled and PVID is also enabled, we must
@@ -1748,6 +1924,9 @@ static int rtl8366rb_reset_chip(struct realtek_priv *priv)
 		return -EIO;
 	}
 
+	rtl83xx_table_invalidate(priv);
+	rtl8366rb_vlan_cache_invalidate(priv);
+
 	return 0;
 }
 
@@ -1816,6 +1995,8 @@ static const struct dsa_switch_ops rtl8366rb_switch_ops = {
 	.port_fast_age = rtl8366rb_port_fast_age,
 	.port_change_mtu = rtl8366rb_change_mtu,
 	.port_max_mtu = rtl8366rb_max_mtu,
+	.port_policer_add = rtl8366rb_port_policer_add,
+	.port_policer_del = rtl8366rb_port_policer_del,
 };
 
 static const struct realtek_ops rtl8366rb_ops = {
@@ -85,15 +85,50 @@ static inline int rtl8366rb_setup_leds(struct realtek_priv *priv)
 
 #endif /* IS_ENABLED(CONFIG_LEDS_CLASS) */
 
+#define RTL8366RB_NUM_VLANS		16
+#define RTL8366RB_NUM_VIDS		4096
+#define RTL8366RB_VLAN_ENTRY_SIZE	3
+/* Each port member config index takes 4 bits, 4 ports per register */
+#define RTL8366RB_PORT_VLAN_CTRL_NUM_REGS	DIV_ROUND_UP(RTL8366RB_NUM_PORTS, 4)
+
+/**
+ * struct rtl8366rb_vlan_cache - in-memory image of the VLAN tables
+ * @vlan4k: member/untag and FID words of each 4K table entry, by VID
+ * @vlan4k_valid: VIDs whose @vlan4k entry is known to match the chip
+ * @vlanmc: the words of each VLAN member configuration
+ * @vlanmc_valid: member configurations whose @vlanmc entry matches the chip
+ * @port_vlan_ctrl: image of the port member config index (PVID) registers
+ * @port_vlan_ctrl_valid: @port_vlan_ctrl matches the chip
+ *
+ * Entries are loaded from the chip on first use and only written back when
+ * their contents change. The VLAN ops accessing the cache are serialized by
+ * RTNL.
+ */
+struct rtl8366rb_vlan_cache {
+	u16 vlan4k[RTL8366RB_NUM_VIDS][RTL8366RB_VLAN_ENTRY_SIZE - 1];
+	DECLARE_BITMAP(vlan4k_valid, RTL8366RB_NUM_VIDS);
+	u16 vlanmc[RTL8366RB_NUM_VLANS][RTL8366RB_VLAN_ENTRY_SIZE];
+	DECLARE_BITMAP(vlanmc_valid, RTL8366RB_NUM_VLANS);
+	u16 port_vlan_ctrl[RTL8366RB_PORT_VLAN_CTRL_NUM_REGS];
+	bool port_vlan_ctrl_valid;
+};
+
 /**
  * struct rtl8366rb - RTL8366RB-specific data
  * @max_mtu: per-port max MTU setting
  * @pvid_enabled: if PVID is set for respective port
+ * @vlan_cache: image of the VLAN tables
+ * @isolation: committed port isolation matrix, indexed by port, protected by
+ *             RTNL
+ * @isolated: bridged ports with BR_ISOLATED set, protected by RTNL
  * @leds: per-port and per-ledgroup led info
  */
 struct rtl8366rb {
 	unsigned int max_mtu[RTL8366RB_NUM_PORTS];
 	bool pvid_enabled[RTL8366RB_NUM_PORTS];
+	struct rtl8366rb_vlan_cache vlan_cache;
+	u32 isolation[RTL8366RB_NUM_PORTS];
+	u32 isolated;
 #if IS_ENABLED(CONFIG_NET_DSA_REALTEK_RTL8366RB_LEDS)
 	struct rtl8366rb_led leds[RTL8366RB_NUM_PORTS][RTL8366RB_NUM_LEDGROUPS];
 #endif
@@ -325,6 +325,323 @@ void rtl83xx_reset_deassert(struct realtek_priv *priv)
 	gpiod_set_value(priv->reset, false);
 }
 
+static int rtl83xx_table_wait(struct realtek_priv *priv,
+			      const struct rtl83xx_table_desc *desc,
+			      u32 *status)
+{
+	u32 val = 0;
+	int ret;
+
+	if (desc->busy_mask) {
+		ret = regmap_read_poll_timeout(priv->map_nolock, desc->busy_reg,
+					       val, !(val & desc->busy_mask),
+					       10, 100);
+		if (ret) {
+			/* Nothing is known about the engine anymore */
+			priv->table.addr_valid = false;
+			return ret;
+		}
+	}
+
+	priv->table.busy = false;
+
+	if (status)
+		*status = val;
+
+	return 0;
+}
+
+static int rtl83xx_table_put_data(struct realtek_priv *priv,
+				  const struct rtl83xx_table_desc *desc,
+				  const u16 *data)
+{
+	unsigned int len = desc->entry_size;
+	int ret;
+
+	if (!desc->last_word_mask)
+		return regmap_bulk_write(priv->map_nolock, desc->wdata_reg,
+					 data, len);
+
+	ret = regmap_bulk_write(priv->map_nolock, desc->wdata_reg, data,
+				len - 1);
+	if (ret)
+		return ret;
+
+	/* The unused bits of a partial last word are reserved and read back as
+	 * zero, so there is no point in preserving them.
+	 */
+	return regmap_write(priv->map_nolock, desc->wdata_reg + len - 1,
+			    data[len - 1] & desc->last_word_mask);
+}
+
+static int __rtl83xx_table_exec(struct realtek_priv *priv,
+				const struct rtl83xx_table_desc *desc,
+				struct rtl83xx_table_op *op)
+{
+	struct rtl83xx_table_state *st = &priv->table;
+	unsigned int len = desc->entry_size;
+	int ret;
+
+	/* A previous write was left running in the background */
+	if (st->busy) {
+		ret = rtl83xx_table_wait(priv, desc, NULL);
+		if (ret)
+			return ret;
+	}
+
+	if (op->wdata) {
+		ret = rtl83xx_table_put_data(priv, desc, op->wdata);
+		if (ret) {
+			st->addr_valid = false;
+			return ret;
+		}
+
+		if (desc->flags & RTL83XX_TABLE_ADDR_IN_DATA) {
+			st->addr = op->wdata[0] & desc->addr_mask;
+			st->addr_valid = true;
+		}
+	}
+
+	if (op->addr != RTL83XX_TABLE_NO_ADDR &&
+	    (!st->addr_valid || st->addr != op->addr)) {
+		ret = regmap_write(priv->map_nolock, desc->addr_reg, op->addr);
+		if (ret) {
+			st->addr_valid = false;
+			return ret;
+		}
+
+		st->addr = op->addr;
+		st->addr_valid = true;
+	}
+
+	ret = regmap_write(priv->map_nolock, desc->ctrl_reg, op->cmd);
+	if (ret)
+		return ret;
+
+	st->busy = !!desc->busy_mask;
+
+	/* Writes complete in the background, the next command waits for them */
+	if (!op->rdata && !op->status)
+		return 0;
+
+	ret = rtl83xx_table_wait(priv, desc, op->status);
+	if (ret)
+		return ret;
+
+	if (!op->rdata)
+		return 0;
+
+	ret = regmap_bulk_read(priv->map_nolock, desc->rdata_reg, op->rdata,
+			       len);
+	if (ret)
+		return ret;
+
+	if (desc->last_word_mask)
+		op->rdata[len - 1] &= desc->last_word_mask;
+
+	return 0;
+}
+
+/**
+ * rtl83xx_table_exec() - run commands on an indirect table access engine
+ * @priv: realtek_priv pointer
+ * @desc: descriptor of the table being accessed
+ * @ops: commands to execute, in order
+ * @count: number of commands in @ops
+ *
+ * Executes a batch of commands while holding the regmap lock, so that the
+ * sequence is not interleaved with other register accesses. The engine
+ * remembers the last address it programmed and whether a command is still
+ * running, so it only rewrites the address register and polls the busy flag
+ * when really needed. Writes are not waited for: the next command, or the
+ * next batch, does that before touching the data registers again.
+ *
+ * Context: Can sleep. Takes and releases priv->map_lock.
+ * Return: 0 on success, negative value for failure.
+ */
+int rtl83xx_table_exec(struct realtek_priv *priv,
+		       const struct rtl83xx_table_desc *desc,
+		       struct rtl83xx_table_op *ops, unsigned int count)
+{
+	unsigned int i;
+	int ret = 0;
+
+	if (!desc->entry_size)
+		return -EOPNOTSUPP;
+
+	rtl83xx_lock(priv);
+	for (i = 0; i < count; i++) {
+		ret = __rtl83xx_table_exec(priv, desc, &ops[i]);
+		if (ret)
+			break;
+	}
+	rtl83xx_unlock(priv);
+
+	return ret;
+}
+EXPORT_SYMBOL_NS_GPL(rtl83xx_table_exec, REALTEK_DSA);
+
+/**
+ * rtl83xx_table_read() - read consecutive table entries
+ * @priv: realtek_priv pointer
+ * @desc: descriptor of the table being read
+ * @addr: address of the first entry
+ * @data: buffer of @count * &rtl83xx_table_desc.entry_size words
+ * @count: number of entries to read
+ *
+ * Context: Can sleep. Takes and releases priv->map_lock.
+ * Return: 0 on success, negative value for failure.
+ */
+int rtl83xx_table_read(struct realtek_priv *priv,
+		       const struct rtl83xx_table_desc *desc, u32 addr,
+		       u16 *data, unsigned int count)
+{
+	struct rtl83xx_table_op op = {
+		.cmd = desc->cmd_read,
+	};
+	unsigned int i;
+	int ret = 0;
+
+	if (!desc->entry_size)
+		return -EOPNOTSUPP;
+
+	if (addr > desc->addr_mask || count > desc->addr_mask + 1 - addr)
+		return -EINVAL;
+
+	rtl83xx_lock(priv);
+	for (i = 0; i < count; i++) {
+		op.addr = addr + i;
+		op.rdata = data + i * desc->entry_size;
+
+		ret = __rtl83xx_table_exec(priv, desc, &op);
+		if (ret)
+			break;
+	}
+	rtl83xx_unlock(priv);
+
+	return ret;
+}
+EXPORT_SYMBOL_NS_GPL(rtl83xx_table_read, REALTEK_DSA);
+
+/**
+ * rtl83xx_table_write() - write consecutive table entries
+ * @priv: realtek_priv pointer
+ * @desc: descriptor of the table being written
+ * @addr: address of the first entry. Ignored for tables with
+ *        RTL83XX_TABLE_ADDR_IN_DATA, where each entry carries its own address.
+ * @data: @count entries of &rtl83xx_table_desc.entry_size words
+ * @count: number of entries to write
+ *
+ * Context: Can sleep. Takes and releases priv->map_lock.
+ * Return: 0 on success, negative value for failure.
+ */
+int rtl83xx_table_write(struct realtek_priv *priv,
+			const struct rtl83xx_table_desc *desc, u32 addr,
+			const u16 *data, unsigned int count)
+{
+	bool addr_in_data = desc->flags & RTL83XX_TABLE_ADDR_IN_DATA;
+	struct rtl83xx_table_op op = {
+		.cmd = desc->cmd_write,
+		.addr = RTL83XX_TABLE_NO_ADDR,
+	};
+	unsigned int i;
+	int ret = 0;
+
+	if (!desc->entry_size)
+		return -EOPNOTSUPP;
+
+	if (!addr_in_data &&
+	    (addr > desc->addr_mask || count > desc->addr_mask + 1 - addr))
+		return -EINVAL;
+
+	rtl83xx_lock(priv);
+	for (i = 0; i < count; i++) {
+		if (!addr_in_data)
+			op.addr = addr + i;
+		op.wdata = data + i * desc->entry_size;
+
+		ret = __rtl83xx_table_exec(priv, desc, &op);
+		if (ret)
+			break;
+	}
+	rtl83xx_unlock(priv);
+
+	return ret;
+}
+EXPORT_SYMBOL_NS_GPL(rtl83xx_table_write, REALTEK_DSA);
+
+/**
+ * rtl83xx_table_invalidate() - forget the table access engine state
+ * @priv: realtek_priv pointer
+ *
+ * Must be called whenever the table access registers might have changed
+ * behind the back of the engine, such as after a chip reset.
+ *
+ * Context: Can sleep. Takes and releases priv->map_lock.
+ * Return: nothing
+ */
+void rtl83xx_table_invalidate(struct realtek_priv *priv)
+{
+	rtl83xx_lock(priv);
+	priv->table.addr_valid = false;
+	priv->table.busy = false;
+	rtl83xx_unlock(priv);
+}
+EXPORT_SYMBOL_NS_GPL(rtl83xx_table_invalidate, REALTEK_DSA);
+
+/**
+ * rtl83xx_port_isolation_commit() - apply a new port isolation matrix
+ * @priv: realtek_priv pointer
+ * @isolation: committed matrix, indexed by port, updated on success
+ * @next: matrix to apply, indexed by port
+ * @write: chip-specific function programming the isolation mask of a port
+ *
+ * Writes the mask of each port whose entry differs between @isolation and
+ * @next, without reading anything back from the switch. If a write fails,
+ * the ports written so far are restored to their committed mask so that the
+ * switch is not left with a half-applied topology.
+ *
+ * Context: Can sleep. Callers serialize changes to @isolation.
+ * Return: 0 on success, negative errno of the failed write otherwise
+ */
+int rtl83xx_port_isolation_commit(struct realtek_priv *priv, u32 *isolation,
+				  const u32 *next,
+				  int (*write)(struct realtek_priv *priv,
+					       int port, u32 mask))
+{
+	unsigned long written = 0;
+	int port;
+	int ret;
+
+	for (port = 0; port < priv->num_ports; port++) {
+		if (next[port] == isolation[port])
+			continue;
+
+		ret = write(priv, port, next[port]);
+		if (ret)
+			goto out_rollback;
+
+		__set_bit(port, &written);
+	}
+
+	memcpy(isolation, next, priv->num_ports * sizeof(*isolation));
+
+	return 0;
+
+out_rollback:
+	dev_err(priv->dev, "failed to set isolation of port %d: %d\n", port,
+		ret);
+
+	for_each_set_bit(port, &written, priv->num_ports)
+		if (write(priv, port, isolation[port]))
+			dev_err(priv->dev,
+				"failed to restore isolation of port %d\n",
+				port);
+
+	return ret;
+}
+EXPORT_SYMBOL_NS_GPL(rtl83xx_port_isolation_commit, REALTEK_DSA);
+
 MODULE_AUTHOR("Luiz Angelo Daros de Luca <luizluca@gmail.com>");
 MODULE_AUTHOR("Linus Walleij <linus.walleij@linaro.org>");
 MODULE_DESCRIPTION("Realtek DSA switches common module");
@@ -8,6 +8,69 @@ struct realtek_interface_info {
 	int (*reg_write)(void *ctx, u32 reg, u32 val);
 };
 
+/* The table address is carried in the first data word instead of a dedicated
+ * address register. Reads write it to &rtl83xx_table_desc.addr_reg, writes
+ * take it from the entry itself.
+ */
+#define RTL83XX_TABLE_ADDR_IN_DATA	BIT(0)
+
+/**
+ * struct rtl83xx_table_desc - indirect table access descriptor
+ * @ctrl_reg: register receiving the command word
+ * @addr_reg: register receiving the entry address
+ * @addr_mask: valid bits of an entry address
+ * @busy_reg: register holding the busy flag, also used as status register
+ * @busy_mask: busy flag in @busy_reg, or 0 if the chip does not report one
+ * @wdata_reg: first of @entry_size consecutive write data registers
+ * @rdata_reg: first of @entry_size consecutive read data registers
+ * @entry_size: size of a table entry in 16-bit words, 0 if not supported
+ * @last_word_mask: valid bits of the last data word, or 0 if all are valid
+ * @cmd_read: command word reading the entry at the programmed address
+ * @cmd_write: command word writing the entry at the programmed address
+ * @flags: RTL83XX_TABLE_* flags
+ *
+ * Describes one table behind the indirect table access engine of a chip.
+ * Tables sharing the same engine must use the same registers, which lets the
+ * engine state in &struct realtek_priv be shared between them.
+ */
+struct rtl83xx_table_desc {
+	u32 ctrl_reg;
+	u32 addr_reg;
+	u32 addr_mask;
+	u32 busy_reg;
+	u32 busy_mask;
+	u32 wdata_reg;
+	u32 rdata_reg;
+	unsigned int entry_size;
+	u16 last_word_mask;
+	u16 cmd_read;
+	u16 cmd_write;
+	unsigned int flags;
+};
+
+#define RTL83XX_TABLE_NO_ADDR		U32_MAX
+
+/**
+ * struct rtl83xx_table_op - a single command for the table access engine
+ * @cmd: command word written to &rtl83xx_table_desc.ctrl_reg
+ * @addr: entry address, or RTL83XX_TABLE_NO_ADDR to leave it untouched
+ * @wdata: entry written to the data registers before the command, or NULL
+ * @rdata: buffer for the entry read back after the command, or NULL
+ * @status: if not NULL, receives &rtl83xx_table_desc.busy_reg once the
+ *          command completed
+ *
+ * Chips using search or lookup methods report their result in the status
+ * register, so such commands are issued through rtl83xx_table_exec() with
+ * @status set.
+ */
+struct rtl83xx_table_op {
+	u16 cmd;
+	u32 addr;
+	const u16 *wdata;
+	u16 *rdata;
+	u32 *status;
+};
+
 void rtl83xx_lock(void *ctx);
 void rtl83xx_unlock(void *ctx);
 int rtl83xx_setup_user_mdio(struct dsa_switch *ds);
@@ -20,5 +83,19 @@ void rtl83xx_shutdown(struct realtek_priv *priv);
 void rtl83xx_remove(struct realtek_priv *priv);
 void rtl83xx_reset_assert(struct realtek_priv *priv);
 void rtl83xx_reset_deassert(struct realtek_priv *priv);
+int rtl83xx_table_exec(struct realtek_priv *priv,
+		       const struct rtl83xx_table_desc *desc,
+		       struct rtl83xx_table_op *ops, unsigned int count);
+int rtl83xx_table_read(struct realtek_priv *priv,
+		       const struct rtl83xx_table_desc *desc, u32 addr,
+		       u16 *data, unsigned int count);
+int rtl83xx_table_write(struct realtek_priv *priv,
+			const struct rtl83xx_table_desc *desc, u32 addr,
+			const u16 *data, unsigned int count);
+void rtl83xx_table_invalidate(struct realtek_priv *priv);
+int rtl83xx_port_isolation_commit(struct realtek_priv *priv, u32 *isolation,
+				  const u32 *next,
+				  int (*write)(struct realtek_priv *priv,
+					       int port, u32 mask));
 
 #endif /* _RTL83XX_H */